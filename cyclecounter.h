@@ -0,0 +1,39 @@
+#ifndef CYCLECOUNTER_H
+#define CYCLECOUNTER_H
+#include <stdint.h>
+
+// Free running 32 bit counter for timing code. Differences of two counts are
+// right across a wrap, as long as less than one full period passed.
+#ifdef SYNTHMAN_HOST
+#include <chrono>
+
+// Host builds count nanoseconds, the 32 bits wrap after 4.29 s
+inline void cycleCounterInit() {}
+
+inline uint32_t cycleCount()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline float cycleCounterHz() { return 1e9f; }
+#else
+#include "stm32h7xx.h"
+
+// The Cortex-M7 DWT cycle counter, core clock cycles
+inline void cycleCounterInit()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    // Unlocks the DWT registers, needed on the M7
+    DWT->LAR = 0xC5ACCE55;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline uint32_t cycleCount() { return DWT->CYCCNT; }
+
+inline float cycleCounterHz() { return (float)SystemCoreClock; }
+#endif
+
+#endif // CYCLECOUNTER_H
@@ -0,0 +1,145 @@
+#ifndef DENORMAL_H
+#define DENORMAL_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+// Denormal policy. Feedback paths that decay towards zero after a note, the
+// ladder stages, the reverb lines and the delay, would otherwise end up in
+// subnormal floats, which x86 handles many times slower than normal ones.
+// Two layers keep silent tails cheap:
+//
+// - DenormalGuard turns on flush-to-zero (and denormals-are-zero on x86)
+//   for a scope. The engine holds one for each process call and render
+//   job, host tools around their render loop.
+// - The feedback paths add SYNTH_DENORMAL_DC to their state, so it settles
+//   at that tiny offset instead of decaying into the subnormal range, with
+//   or without the guard. 1e-18 is 360 dB down and vanishes in the rounding
+//   of any audible sample.
+//
+// Building with SYNTH_DENORMAL_GUARD=0 and SYNTH_DENORMAL_DC=0 turns the
+// policy off, for measuring what it saves. DenormalCounter counts the
+// subnormals in the feedback states, with the guard off so they can show.
+#ifndef SYNTH_DENORMAL_GUARD
+#define SYNTH_DENORMAL_GUARD 1
+#endif
+#ifndef SYNTH_DENORMAL_DC
+#define SYNTH_DENORMAL_DC 1e-18f
+#endif
+
+#define DENORMAL_MAX_STAGES 8
+
+inline bool isSubnormal(float x)
+{
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x7f800000u) == 0 && (bits & 0x007fffffu) != 0;
+}
+
+// Flush-to-zero for the lifetime of the guard, the previous mode comes back
+// when it goes out of scope. The mode is per thread. A guard that is not
+// enabled leaves the mode alone.
+class DenormalGuard
+{
+public:
+    explicit DenormalGuard(bool enabled = true) : enabled_(enabled), saved_(0)
+    {
+        if (!enabled_)
+        {
+            return;
+        }
+#if SYNTH_DENORMAL_GUARD && (defined(__SSE__) || defined(_M_X64))
+        saved_ = _mm_getcsr();
+        // FTZ and DAZ
+        _mm_setcsr(saved_ | 0x8040);
+#elif SYNTH_DENORMAL_GUARD && defined(__aarch64__)
+        uint64_t fpcr;
+        __asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+        saved_ = fpcr;
+        __asm__ volatile("msr fpcr, %0" : : "r"(fpcr | (1u << 24)));
+#elif SYNTH_DENORMAL_GUARD && defined(__ARM_FP)
+        // The Cortex-M7's FPSCR, FZ is bit 24
+        uint32_t fpscr;
+        __asm__ volatile("vmrs %0, fpscr" : "=r"(fpscr));
+        saved_ = fpscr;
+        __asm__ volatile("vmsr fpscr, %0" : : "r"(fpscr | (1u << 24)));
+#endif
+    }
+
+    ~DenormalGuard()
+    {
+        if (!enabled_)
+        {
+            return;
+        }
+#if SYNTH_DENORMAL_GUARD && (defined(__SSE__) || defined(_M_X64))
+        _mm_setcsr(saved_);
+#elif SYNTH_DENORMAL_GUARD && defined(__aarch64__)
+        uint64_t fpcr = saved_;
+        __asm__ volatile("msr fpcr, %0" : : "r"(fpcr));
+#elif SYNTH_DENORMAL_GUARD && defined(__ARM_FP)
+        uint32_t fpscr = saved_;
+        __asm__ volatile("vmsr fpscr, %0" : : "r"(fpscr));
+#endif
+    }
+
+    DenormalGuard(const DenormalGuard &) = delete;
+    DenormalGuard &operator=(const DenormalGuard &) = delete;
+
+private:
+    bool enabled_;
+    uint32_t saved_;
+};
+
+// Debug counters of subnormal values in each stage's feedback state, for
+// checking the policy keeps them out. Under flush-to-zero no arithmetic
+// result is subnormal, so they only count anything with the guard off.
+class DenormalCounter
+{
+public:
+    DenormalCounter() { reset(); }
+
+    void reset()
+    {
+        for (int s = 0; s < DENORMAL_MAX_STAGES; s++)
+        {
+            blocks_[s] = values_[s] = found_[s] = 0;
+        }
+    }
+
+    // Adds the subnormals among values to a stage's count for this block
+    void count(int stage, const float *values, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            found_[stage] += isSubnormal(values[i]);
+        }
+    }
+
+    // Folds the block's counts into the totals, once per block
+    void endBlock()
+    {
+        for (int s = 0; s < DENORMAL_MAX_STAGES; s++)
+        {
+            values_[s] += found_[s];
+            blocks_[s] += found_[s] > 0;
+            found_[s] = 0;
+        }
+    }
+
+    // Blocks that left at least one subnormal in a stage's state, and how
+    // many subnormal values were found in all
+    uint32_t getBlocks(int stage) const { return blocks_[stage]; }
+    uint32_t getValues(int stage) const { return values_[stage]; }
+
+private:
+    uint32_t blocks_[DENORMAL_MAX_STAGES];
+    uint32_t values_[DENORMAL_MAX_STAGES];
+    uint32_t found_[DENORMAL_MAX_STAGES];
+};
+
+#endif // DENORMAL_H
@@ -0,0 +1,258 @@
+#include "envelopebank.h"
+#include <math.h>
+
+// Adsr aims past the ends of its segments so they end in finite time:
+// attack at 1 on its way to 1.01, release and a zero sustain decay at 0 on
+// their way to -0.01
+static const float ATTACK_TARGET = 1.01f;
+static const float FLOOR_TARGET = -0.01f;
+// Stands in for a segment that doesn't end by itself
+static const int32_t FOREVER = INT32_MAX;
+
+// Samples a one-pole approach from level towards target with the given
+// step takes to cross end, the crossing sample included
+static int32_t samplesUntil(float level, float step, float target, float end)
+{
+    if (step >= 1.0f)
+    {
+        return 1;
+    }
+
+    float remaining = (end - target) / (level - target);
+    if (remaining >= 1.0f)
+    {
+        return 1;
+    }
+    if (remaining <= 0.0f)
+    {
+        return FOREVER;
+    }
+
+    float samples = floorf(logf(remaining) / logf(1.0f - step)) + 1.0f;
+    return samples < (float)FOREVER ? (int32_t)samples : FOREVER;
+}
+
+// Adsr's step for a segment that covers all but e^logRemaining of the way
+// to its target in the given time
+static float segmentStep(float seconds, float sampleRate, float logRemaining)
+{
+    if (seconds <= 0.0f)
+    {
+        return 1.0f;
+    }
+    return 1.0f - expf(logRemaining / (seconds * sampleRate));
+}
+
+EnvelopeBank::EnvelopeBank() {}
+EnvelopeBank::~EnvelopeBank() {}
+
+void EnvelopeBank::initialize(float sampleRate)
+{
+    sampleRate_ = sampleRate;
+
+    for (int i = 0; i < ENVELOPEBANK_MAX_VOICES; i++)
+    {
+        startSegment(i, ENVELOPE_IDLE);
+    }
+
+    // Adsr's defaults
+    setTime(ENVELOPE_ATTACK, 0.1f);
+    setTime(ENVELOPE_DECAY, 0.1f);
+    setTime(ENVELOPE_RELEASE, 0.1f);
+    sustain_ = 0.7f;
+
+    // Reaches 0 on the way to FLOOR_TARGET in the fade time from 1
+    fadeStep_ = segmentStep(ENVELOPEBANK_FADE_TIME, sampleRate_, logf(-FLOOR_TARGET / (1.0f - FLOOR_TARGET)));
+}
+
+void EnvelopeBank::setTime(int segment, float seconds)
+{
+    switch (segment)
+    {
+    case ENVELOPE_ATTACK:
+        // Reaches 1 on the way to ATTACK_TARGET in the given time
+        attackStep_ = segmentStep(seconds, sampleRate_, logf(1.0f - 1.0f / ATTACK_TARGET));
+        break;
+    case ENVELOPE_DECAY:
+        // The others take the time as a time constant
+        decayStep_ = segmentStep(seconds, sampleRate_, -1.0f);
+        break;
+    case ENVELOPE_RELEASE:
+        releaseStep_ = segmentStep(seconds, sampleRate_, -1.0f);
+        break;
+    default:
+        return;
+    }
+
+    // Running segments pick the new time up from where they are
+    for (int i = 0; i < ENVELOPEBANK_MAX_VOICES; i++)
+    {
+        if (segment_[i] == segment)
+        {
+            startSegment(i, segment);
+        }
+    }
+}
+
+void EnvelopeBank::setSustainLevel(float level)
+{
+    sustain_ = level <= 0.0f ? FLOOR_TARGET : (level > 1.0f ? 1.0f : level);
+
+    for (int i = 0; i < ENVELOPEBANK_MAX_VOICES; i++)
+    {
+        if (segment_[i] == ENVELOPE_DECAY)
+        {
+            startSegment(i, ENVELOPE_DECAY);
+        }
+    }
+}
+
+void EnvelopeBank::trigger(int voice)
+{
+    startSegment(voice, ENVELOPE_ATTACK);
+}
+
+void EnvelopeBank::release(int voice)
+{
+    if (segment_[voice] == ENVELOPE_ATTACK || segment_[voice] == ENVELOPE_DECAY)
+    {
+        startSegment(voice, ENVELOPE_RELEASE);
+    }
+}
+
+void EnvelopeBank::fadeOut(int voice)
+{
+    if (segment_[voice] != ENVELOPE_IDLE)
+    {
+        startRelease(voice, fadeStep_);
+    }
+}
+
+void EnvelopeBank::startSegment(int voice, int segment)
+{
+    float level = level_[voice];
+    float step = 0.0f, target = 0.0f;
+    int32_t remaining = FOREVER;
+
+    switch (segment)
+    {
+    case ENVELOPE_ATTACK:
+        step = attackStep_;
+        target = ATTACK_TARGET;
+        remaining = samplesUntil(level, step, target, 1.0f);
+        break;
+    case ENVELOPE_DECAY:
+        step = decayStep_;
+        target = sustain_;
+        if (target < 0.0f)
+        {
+            remaining = samplesUntil(level, step, target, 0.0f);
+        }
+        break;
+    case ENVELOPE_RELEASE:
+        startRelease(voice, releaseStep_);
+        return;
+    case ENVELOPE_IDLE:
+    default:
+        // Coefficient and offset 0 hold the level at 0
+        level_[voice] = 0.0f;
+        break;
+    }
+
+    segment_[voice] = segment;
+    coefficient_[voice] = 1.0f - step;
+    offset_[voice] = step * target;
+    remaining_[voice] = remaining;
+}
+
+void EnvelopeBank::startRelease(int voice, float step)
+{
+    segment_[voice] = ENVELOPE_RELEASE;
+    coefficient_[voice] = 1.0f - step;
+    offset_[voice] = step * FLOOR_TARGET;
+    remaining_[voice] = samplesUntil(level_[voice], step, FLOOR_TARGET, 0.0f);
+}
+
+// Lands a segment on its end and moves on to the next one
+void EnvelopeBank::endSegment(int voice)
+{
+    if (segment_[voice] == ENVELOPE_ATTACK)
+    {
+        level_[voice] = 1.0f;
+        startSegment(voice, ENVELOPE_DECAY);
+        return;
+    }
+
+    startSegment(voice, ENVELOPE_IDLE);
+}
+
+void EnvelopeBank::process(float *const *out, int numVoices, const int *activeVoices, int numActive, size_t size)
+{
+    int lastFirst = -1;
+
+    for (int a = 0; a < numActive; a++)
+    {
+        int first = activeVoices[a] - activeVoices[a] % SIMD_LANES;
+        if (first == lastFirst)
+        {
+            continue;
+        }
+
+        int lanes = numVoices - first < SIMD_LANES ? numVoices - first : SIMD_LANES;
+        processGroup(out, first, lanes, size);
+        lastFirst = first;
+    }
+}
+
+void EnvelopeBank::processGroup(float *const *out, int first, int lanes, size_t size)
+{
+    size_t done = 0;
+
+    while (done < size)
+    {
+        // Run up to the first segment end in the group, or the block's end
+        size_t span = size - done;
+        for (int l = 0; l < lanes; l++)
+        {
+            if ((size_t)remaining_[first + l] < span)
+            {
+                span = remaining_[first + l];
+            }
+        }
+
+        f32x4 level = simdLoad(&level_[first]);
+        const f32x4 coefficient = simdLoad(&coefficient_[first]);
+        const f32x4 offset = simdLoad(&offset_[first]);
+
+        for (size_t i = done; i < done + span; i++)
+        {
+            level = level * coefficient + offset;
+
+            float sample[SIMD_LANES];
+            simdStore(sample, level);
+            for (int l = 0; l < lanes; l++)
+            {
+                out[first + l][i] = sample[l];
+            }
+        }
+
+        simdStore(&level_[first], level);
+        done += span;
+
+        for (int l = 0; l < lanes; l++)
+        {
+            int v = first + l;
+            if (remaining_[v] == FOREVER)
+            {
+                continue;
+            }
+
+            remaining_[v] -= span;
+            if (remaining_[v] == 0)
+            {
+                endSegment(v);
+                out[v][done - 1] = level_[v];
+            }
+        }
+    }
+}
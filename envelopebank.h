@@ -0,0 +1,80 @@
+#ifndef ENVELOPEBANK_H
+#define ENVELOPEBANK_H
+#include <stddef.h>
+#include <stdint.h>
+#include "simd.h"
+
+#define ENVELOPEBANK_MAX_VOICES 64
+// Seconds fadeOut takes from full level to silence
+#define ENVELOPEBANK_FADE_TIME 0.005f
+
+enum EnvelopeSegment
+{
+    ENVELOPE_IDLE,
+    ENVELOPE_ATTACK,
+    ENVELOPE_DECAY, // Holds at the sustain level once it gets there
+    ENVELOPE_RELEASE,
+};
+
+// The ADSR envelopes of all voices, with the curves of DaisySP's Adsr, as
+// structure-of-arrays advancing SIMD_LANES voices per instruction. Each
+// segment is a one-pole approach to a target past its end, which is
+// level = level * coefficient + offset per sample with no branches. How
+// many samples a segment has left is worked out when it starts, so blocks
+// are split at the few samples where a lane changes segment instead of
+// testing every sample. Times and sustain are shared by all voices.
+class EnvelopeBank
+{
+public:
+    EnvelopeBank();
+    ~EnvelopeBank();
+
+    void initialize(float sampleRate);
+
+    // Seconds for ENVELOPE_ATTACK, ENVELOPE_DECAY or ENVELOPE_RELEASE
+    void setTime(int segment, float seconds);
+    void setSustainLevel(float level);
+
+    // Attacks from the current level, like Adsr::Retrigger(false)
+    void trigger(int voice);
+    // Releases a voice that is not already releasing or idle
+    void release(int voice);
+    // Releases a voice that is not idle within ENVELOPEBANK_FADE_TIME,
+    // whatever the release time, for cutting voices without a click
+    void fadeOut(int voice);
+
+    // A voice is idle once its release reaches 0, then it renders silence
+    // until the next trigger and its voice can be skipped
+    bool isIdle(int voice) const { return segment_[voice] == ENVELOPE_IDLE; }
+    // Level after the last sample processed
+    float getLevel(int voice) const { return level_[voice]; }
+
+    // Writes each voice's envelope to out. Only the lane groups holding
+    // one of the ascending activeVoices are processed, idle lanes in those
+    // groups are written too.
+    void process(float *const *out, int numVoices, const int *activeVoices, int numActive, size_t size);
+
+private:
+    float sampleRate_;
+
+    // Adsr's per-sample step towards the target, per segment
+    float attackStep_;
+    float decayStep_;
+    float releaseStep_;
+    float fadeStep_;
+    float sustain_;
+
+    float level_[ENVELOPEBANK_MAX_VOICES];
+    float coefficient_[ENVELOPEBANK_MAX_VOICES];
+    float offset_[ENVELOPEBANK_MAX_VOICES];
+    // Samples until the segment ends, the last one lands on its end
+    int32_t remaining_[ENVELOPEBANK_MAX_VOICES];
+    uint8_t segment_[ENVELOPEBANK_MAX_VOICES];
+
+    void startSegment(int voice, int segment);
+    void startRelease(int voice, float step);
+    void endSegment(int voice);
+    void processGroup(float *const *out, int first, int lanes, size_t size);
+};
+
+#endif // ENVELOPEBANK_H
@@ -0,0 +1,61 @@
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Single producer, single consumer ring buffer. One thread may push and one
+// other thread may peek/pop without locks; Size must be a power of two and
+// holds Size - 1 items.
+template <typename T, size_t Size>
+class EventQueue
+{
+public:
+    EventQueue() : head_(0), tail_(0) {}
+
+    // Producer side. Returns false when the queue is full.
+    bool push(const T &item)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t next = (head + 1) & (Size - 1);
+
+        if (next == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        items_[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns the oldest item without removing it, or
+    // nullptr when the queue is empty.
+    const T *peek() const
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+
+        if (tail == head_.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
+        return &items_[tail];
+    }
+
+    // Consumer side, removes the item peek() returned
+    void pop()
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        tail_.store((tail + 1) & (Size - 1), std::memory_order_release);
+    }
+
+private:
+    static_assert((Size & (Size - 1)) == 0, "EventQueue size must be a power of two");
+
+    T items_[Size];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+};
+
+#endif // EVENTQUEUE_H
@@ -0,0 +1,726 @@
+// Kernel benchmarks for the DSP code in this repo.
+//
+// Each benchmark prints ns and cycles per sample, plus any accuracy figures
+// that go with it. Cycles come from the TSC on x86 and are only an estimate
+// of core cycles there.
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif
+
+#include "moogladder.h"
+#include "moogladderbank.h"
+#include "modmatrix.h"
+#include "oversampler.h"
+#include "pitch.h"
+#include "reverbsc.h"
+#include "stereodelay.h"
+#include "delayline.h"
+
+using namespace daisysp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const float sampleRate = 48000.0f;
+static const size_t blockSize = 16;
+static const size_t benchSamples = 48000 * 20;
+
+struct Timing
+{
+    double ns;
+    double cycles;
+};
+
+// Times fn(offset, size) over benchSamples samples in blocks of blockSize
+template <typename Fn>
+static Timing timeBlocks(Fn fn)
+{
+    Clock::time_point start = Clock::now();
+#ifdef HAVE_TSC
+    unsigned long long startCycles = __rdtsc();
+#endif
+
+    for (size_t offset = 0; offset < benchSamples; offset += blockSize)
+    {
+        fn(offset, blockSize);
+    }
+
+    Timing t;
+    t.ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / benchSamples;
+#ifdef HAVE_TSC
+    t.cycles = (double)(__rdtsc() - startCycles) / benchSamples;
+#else
+    t.cycles = 0.0;
+#endif
+    return t;
+}
+
+static void printTiming(const char *name, Timing t)
+{
+    printf("  %-28s %8.2f ns/sample %8.1f cycles/sample\n", name, t.ns, t.cycles);
+}
+
+// Sawtooth, amplitude scales how hard the ladder is driven
+static std::vector<float> testSignal(float amplitude, float frequency = 110.0f)
+{
+    std::vector<float> signal(benchSamples);
+    float phase = 0.0f;
+
+    for (size_t i = 0; i < benchSamples; i++)
+    {
+        signal[i] = amplitude * (1.0f - 2.0f * phase);
+        phase += frequency / sampleRate;
+        if (phase >= 1.0f)
+        {
+            phase -= 1.0f;
+        }
+    }
+
+    return signal;
+}
+
+static const char *saturatorNames[] = {"legacy", "exact", "pade", "lut"};
+
+// Worst case error of a saturator against double precision tanh over [-8, 8]
+static double saturatorError(MoogLadder::Saturator saturator)
+{
+    double worst = 0.0;
+
+    for (int i = -800000; i <= 800000; i++)
+    {
+        double x = i / 100000.0;
+        worst = fmax(worst, fabs(MoogLadder::Saturate(saturator, (float)x) - tanh(x)));
+    }
+
+    return worst;
+}
+
+static void benchLadder()
+{
+    printf("moogladder\n");
+    printf(" saturator error against tanh over [-8, 8]\n");
+
+    for (int s = MoogLadder::SATURATOR_LEGACY; s <= MoogLadder::SATURATOR_LUT; s++)
+    {
+        printf("  %-28s %.3g\n", saturatorNames[s], saturatorError(static_cast<MoogLadder::Saturator>(s)));
+    }
+
+    const float amplitudes[] = {1.0f, 40000.0f};
+    const char *levelNames[] = {"unity input", "driven input"};
+
+    for (int level = 0; level < 2; level++)
+    {
+        std::vector<float> input = testSignal(amplitudes[level]);
+        std::vector<float> reference(input), output(input);
+
+        printf(" %s\n", levelNames[level]);
+
+        // The per-sample Process() call as the engine used it before block processing
+        {
+            MoogLadder ladder;
+            ladder.Init(sampleRate);
+            ladder.SetSaturator(MoogLadder::SATURATOR_LEGACY);
+            ladder.SetFreq(2000.0f);
+            ladder.SetRes(0.7f);
+            std::vector<float> buf(input);
+            Timing t = timeBlocks([&](size_t offset, size_t size) {
+                for (size_t i = 0; i < size; i++)
+                {
+                    buf[offset + i] = ladder.Process(buf[offset + i]);
+                }
+            });
+            printTiming("legacy, Process per sample", t);
+        }
+
+        for (int s = MoogLadder::SATURATOR_LEGACY; s <= MoogLadder::SATURATOR_LUT; s++)
+        {
+            MoogLadder ladder;
+            ladder.Init(sampleRate);
+            ladder.SetSaturator(static_cast<MoogLadder::Saturator>(s));
+            ladder.SetFreq(2000.0f);
+            ladder.SetRes(0.7f);
+            std::vector<float> &buf = s == MoogLadder::SATURATOR_EXACT ? reference : output;
+            buf = input;
+
+            Timing t = timeBlocks([&](size_t offset, size_t size) {
+                ladder.ProcessBlock(&buf[offset], size);
+            });
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s, ProcessBlock", saturatorNames[s]);
+            printTiming(name, t);
+
+            if (s > MoogLadder::SATURATOR_EXACT)
+            {
+                double worst = 0.0, peak = 0.0;
+                for (size_t i = 0; i < benchSamples; i++)
+                {
+                    worst = fmax(worst, fabs(output[i] - reference[i]));
+                    peak = fmax(peak, fabs(reference[i]));
+                }
+                printf("  %-28s max |error| against exact %.3g (peak %.3g)\n", "", worst, peak);
+            }
+        }
+    }
+}
+
+// Bin of the aliasing test tone in an aliasingSize point DFT. 427 of 4096
+// is about 5 kHz, and the harmonics above Nyquist fold onto bins that are
+// not multiples of it.
+static const int aliasingBin = 427;
+static const int aliasingSize = 4096;
+
+// Power of the bins that are not harmonics of the test tone, relative to the
+// ones that are. The tone repeats exactly every aliasingSize samples, so
+// every component lands on a whole bin.
+static double aliasingDb(const float *signal)
+{
+    double harmonic = 0.0, alias = 0.0;
+
+    for (int bin = 1; bin < aliasingSize / 2; bin++)
+    {
+        // Goertzel
+        double w = 2.0 * M_PI * bin / aliasingSize;
+        double c = 2.0 * cos(w), s1 = 0.0, s2 = 0.0;
+        for (int i = 0; i < aliasingSize; i++)
+        {
+            double s0 = signal[i] + c * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+        double power = s1 * s1 + s2 * s2 - c * s1 * s2;
+
+        if (bin % aliasingBin == 0)
+        {
+            harmonic += power;
+        }
+        else
+        {
+            alias += power;
+        }
+    }
+
+    return 10.0 * log10(alias / harmonic);
+}
+
+static void benchOversample()
+{
+    printf("oversample\n");
+    printf(" driven ladder, PADE saturator\n");
+
+    std::vector<float> input = testSignal(40000.0f);
+    const int factors[] = {1, 2, 4};
+
+    for (int f = 0; f < 3; f++)
+    {
+        MoogLadder ladder;
+        ladder.Init(sampleRate);
+        ladder.SetOversampling(factors[f]);
+        ladder.SetFreq(2000.0f);
+        ladder.SetRes(0.7f);
+        std::vector<float> buf(input);
+
+        Timing t = timeBlocks([&](size_t offset, size_t size) {
+            ladder.ProcessBlock(&buf[offset], size);
+        });
+
+        // A sine driven into the saturators, after the filters have settled
+        ladder.Init(sampleRate);
+        ladder.SetOversampling(factors[f]);
+        ladder.SetFreq(16000.0f);
+        ladder.SetRes(0.3f);
+        std::vector<float> tone(8 * aliasingSize);
+        for (size_t i = 0; i < tone.size(); i++)
+        {
+            tone[i] = 40000.0f * sinf(2.0f * (float)M_PI * aliasingBin * (i % aliasingSize) / aliasingSize);
+        }
+        for (size_t i = 0; i < tone.size(); i += blockSize)
+        {
+            ladder.ProcessBlock(&tone[i], blockSize);
+        }
+
+        Oversampler oversampler;
+        oversampler.initialize(factors[f]);
+
+        char name[64];
+        snprintf(name, sizeof(name), "%dx, ProcessBlock", factors[f]);
+        printTiming(name, t);
+        printf("  %-28s aliasing %.1f dB against the harmonics, latency %d samples\n", "",
+               aliasingDb(&tone[tone.size() - aliasingSize]), oversampler.getLatency());
+    }
+}
+
+// Eight voices filtered separately, as the engine's per-voice filter mode does
+static void benchLadderBank()
+{
+    const int numVoices = 8;
+    const int activeVoices[numVoices] = {0, 1, 2, 3, 4, 5, 6, 7};
+    std::vector<float> input[numVoices], reference[numVoices], output[numVoices];
+
+    printf("moogladderbank, %d voices\n", numVoices);
+
+    for (int v = 0; v < numVoices; v++)
+    {
+        input[v] = testSignal(1.0f, 110.0f * (1.0f + 0.25f * v));
+        reference[v] = output[v] = input[v];
+    }
+
+    // One ladder on the mix, the engine's default
+    {
+        MoogLadder ladder;
+        ladder.Init(sampleRate);
+        ladder.SetFreq(2000.0f);
+        ladder.SetRes(0.7f);
+        std::vector<float> mix(input[0]);
+        Timing t = timeBlocks([&](size_t offset, size_t size) {
+            ladder.ProcessBlock(&mix[offset], size);
+        });
+        printTiming("MoogLadder on the mix", t);
+    }
+
+    {
+        MoogLadder ladders[numVoices];
+        for (int v = 0; v < numVoices; v++)
+        {
+            ladders[v].Init(sampleRate);
+            ladders[v].SetRes(0.7f);
+        }
+        Timing t = timeBlocks([&](size_t offset, size_t size) {
+            for (int v = 0; v < numVoices; v++)
+            {
+                ladders[v].SetFreq(2000.0f + 100.0f * v);
+                ladders[v].ProcessBlock(&reference[v][offset], size);
+            }
+        });
+        printTiming("MoogLadder per voice", t);
+    }
+
+    {
+        MoogLadderBank bank;
+        bank.initialize(sampleRate);
+        float *buffers[numVoices];
+        Timing t = timeBlocks([&](size_t offset, size_t size) {
+            for (int v = 0; v < numVoices; v++)
+            {
+                bank.setVoice(v, 2000.0f + 100.0f * v, 0.7f);
+                buffers[v] = &output[v][offset];
+            }
+            bank.process(buffers, numVoices, activeVoices, numVoices, size);
+        });
+        printTiming("MoogLadderBank", t);
+    }
+
+    double worst = 0.0, peak = 0.0;
+    for (int v = 0; v < numVoices; v++)
+    {
+        for (size_t i = 0; i < benchSamples; i++)
+        {
+            worst = fmax(worst, fabs(output[v][i] - reference[v][i]));
+            peak = fmax(peak, fabs(reference[v][i]));
+        }
+    }
+    printf("  %-28s max |error| against MoogLadder %.3g (peak %.3g)\n", "", worst, peak);
+}
+
+// Eight routes across 32 voices, evaluated once per block as the engine does,
+// against a sine LFO per voice per route run every sample
+static void benchModMatrix()
+{
+    const int numVoices = 32;
+    const float rate = 5.0f;
+    float out[numVoices][__MOD_DESTINATION_COUNT];
+    // Keeps the loops below from being optimized away
+    volatile float sink = 0.0f;
+
+    printf("modmatrix, %d voices, %d routes\n", numVoices, MODMATRIX_ROUTES);
+
+    {
+        float phase[numVoices][MODMATRIX_ROUTES] = {};
+        Timing t = timeBlocks([&](size_t offset, size_t size) {
+            for (int v = 0; v < numVoices; v++)
+            {
+                for (size_t i = 0; i < size; i++)
+                {
+                    for (int r = 0; r < MODMATRIX_ROUTES; r++)
+                    {
+                        sink += sinf(6.28318531f * phase[v][r]);
+                        phase[v][r] += rate / sampleRate;
+                        phase[v][r] -= (int)phase[v][r];
+                    }
+                }
+            }
+        });
+        printTiming("per-voice LFOs per sample", t);
+    }
+
+    const int sources[] = {MOD_LFO1, MOD_VOICE_LFO, MOD_ENVELOPE};
+    const char *names[] = {"ModMatrix, global LFO", "ModMatrix, voice LFO", "ModMatrix, envelope"};
+
+    for (int s = 0; s < 3; s++)
+    {
+        ModMatrix matrix;
+        matrix.initialize(sampleRate);
+        matrix.setLfoRate(MOD_LFO1, rate);
+        matrix.setLfoRate(MOD_VOICE_LFO, rate);
+        for (int r = 0; r < MODMATRIX_ROUTES; r++)
+        {
+            matrix.setRoute(r, sources[s], r % __MOD_DESTINATION_COUNT, 0.1f);
+        }
+
+        Timing t = timeBlocks([&](size_t offset, size_t size) {
+            matrix.beginBlock(size);
+            for (int v = 0; v < numVoices; v++)
+            {
+                matrix.evaluate(v, 0.5f, 1.0f, size, out[v]);
+                sink += out[v][MOD_PITCH];
+            }
+        });
+        printTiming(names[s], t);
+    }
+}
+
+// fastExp2's documented bound
+static const double exp2Tolerance = 4e-7;
+
+// Worst relative error of fastExp2 against double precision exp2
+static double exp2Error(float x, double worst)
+{
+    return fmax(worst, fabs(fastExp2(x) / exp2((double)x) - 1.0));
+}
+
+static bool benchPitch()
+{
+    // Vibrato depths across a few octaves, as semitonesToRatio sees them
+    std::vector<float> input(benchSamples);
+    for (size_t i = 0; i < benchSamples; i++)
+    {
+        input[i] = 2.0f * sinf(i * 0.001f);
+    }
+    volatile float sink = 0.0f;
+
+    printf("pitch, exp2 of vibrato-sized exponents\n");
+
+    Timing t = timeBlocks([&](size_t offset, size_t size) {
+        for (size_t i = offset; i < offset + size; i++)
+        {
+            sink += powf(2.0f, input[i]);
+        }
+    });
+    printTiming("powf", t);
+
+    t = timeBlocks([&](size_t offset, size_t size) {
+        for (size_t i = offset; i < offset + size; i++)
+        {
+            sink += fastExp2(input[i]);
+        }
+    });
+    printTiming("fastExp2", t);
+
+    double sweep = 0.0, tiny = 0.0, integers = 0.0;
+    for (int i = -8000000; i <= 8000000; i++)
+    {
+        sweep = exp2Error(i * 1e-6f, sweep);
+    }
+    // Where x - floor(x) rounds to 1, as a slow LFO near a zero crossing gives
+    for (float x = -1e-6f; x < -1e-30f; x *= 0.9f)
+    {
+        tiny = exp2Error(x, tiny);
+        tiny = exp2Error(-x, tiny);
+    }
+    // Exact integers, and the float just below each inside the clamped range
+    for (int i = -126; i <= 127; i++)
+    {
+        integers = exp2Error((float)i, integers);
+        if (i > -126)
+        {
+            integers = exp2Error(nextafterf((float)i, -200.0f), integers);
+        }
+    }
+
+    bool pass = sweep < exp2Tolerance && tiny < exp2Tolerance && integers < exp2Tolerance;
+    printf("  %-28s max relative error %.3g over [-8, 8], %.3g near 0, %.3g at integers: %s\n",
+           "", sweep, tiny, integers, pass ? "ok" : "FAIL");
+    return pass;
+}
+
+// Too large for the stack
+static ReverbSc reverbScalar, reverbBlock;
+
+static void benchReverb()
+{
+    std::vector<float> input = testSignal(0.3f, 220.0f);
+    std::vector<float> refLeft(benchSamples), refRight(benchSamples);
+    std::vector<float> left(benchSamples), right(benchSamples);
+
+    // Gate the input so the tails are part of the comparison
+    for (size_t i = 0; i < benchSamples; i++)
+    {
+        if ((i / 24000) % 2)
+        {
+            input[i] = 0.0f;
+        }
+    }
+
+    printf("reverbsc\n");
+
+    ReverbSc *reverbs[2] = {&reverbScalar, &reverbBlock};
+    for (int r = 0; r < 2; r++)
+    {
+        reverbs[r]->Init(sampleRate);
+        reverbs[r]->SetLpFreq(18000.0f);
+        reverbs[r]->SetFeedback(0.85f);
+    }
+
+    Timing t = timeBlocks([&](size_t offset, size_t size) {
+        for (size_t i = offset; i < offset + size; i++)
+        {
+            reverbScalar.Process(input[i], input[i], &refLeft[i], &refRight[i]);
+        }
+    });
+    printTiming("Process per sample", t);
+
+    t = timeBlocks([&](size_t offset, size_t size) {
+        reverbBlock.ProcessBlock(&input[offset], &input[offset], &left[offset], &right[offset], size);
+    });
+    printTiming("ProcessBlock", t);
+
+    double worst = 0.0, peak = 0.0;
+    for (size_t i = 0; i < benchSamples; i++)
+    {
+        worst = fmax(worst, fmax(fabs(left[i] - refLeft[i]), fabs(right[i] - refRight[i])));
+        peak = fmax(peak, fmax(fabs(refLeft[i]), fabs(refRight[i])));
+    }
+    printf("  %-28s max |error| against Process %.3g (peak %.3g)\n", "", worst, peak);
+}
+
+// Storage formats are acceptable while the error they add to the wet signal
+// stays this far below the signal itself. bfloat16's 8 bit mantissa puts it
+// around 55 dB, int16 reaches about 77 dB.
+static const double storageThresholdDb = -50.0;
+
+static ReverbScT<StorageInt16> reverbInt16;
+static ReverbScT<StorageBf16> reverbBf16;
+
+template <typename Reverb>
+static bool benchReverbStorage(Reverb &reverb,
+                               const char *name,
+                               const std::vector<float> &input,
+                               const std::vector<float> &refLeft,
+                               const std::vector<float> &refRight)
+{
+    std::vector<float> left(benchSamples), right(benchSamples);
+
+    reverb.Init(sampleRate);
+    reverb.SetLpFreq(18000.0f);
+    reverb.SetFeedback(0.85f);
+
+    Timing t = timeBlocks([&](size_t offset, size_t size) {
+        reverb.ProcessBlock(&input[offset], &input[offset], &left[offset], &right[offset], size);
+    });
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s, %zu KB", name, sizeof(Reverb) / 1024);
+    printTiming(label, t);
+
+    double error = 0.0, signal = 0.0, worst = 0.0;
+    for (size_t i = 0; i < benchSamples; i++)
+    {
+        double dl = left[i] - refLeft[i], dr = right[i] - refRight[i];
+        error += dl * dl + dr * dr;
+        signal += (double)refLeft[i] * refLeft[i] + (double)refRight[i] * refRight[i];
+        worst = fmax(worst, fmax(fabs(dl), fabs(dr)));
+    }
+
+    double db = error > 0.0 ? 10.0 * log10(error / signal) : -INFINITY;
+    bool pass = db < storageThresholdDb;
+    printf("  %-28s error %.1f dB below the signal, max |error| %.3g: %s\n",
+           "", -db, worst, pass ? "ok" : "FAIL");
+    return pass;
+}
+
+// Delay memory formats against the float reverb, fails past storageThresholdDb
+static bool benchReverbStorage()
+{
+    std::vector<float> input(benchSamples);
+    std::vector<float> refLeft(benchSamples), refRight(benchSamples);
+
+    // A few detuned saws at a realistic mix level, gated to leave tails
+    const float chord[] = {130.81f, 164.81f, 196.0f, 261.63f};
+    for (int n = 0; n < 4; n++)
+    {
+        std::vector<float> voice = testSignal(0.15f, chord[n] * 1.003f);
+        for (size_t i = 0; i < benchSamples; i++)
+        {
+            input[i] += (i / 48000) % 3 == 2 ? 0.0f : voice[i];
+        }
+    }
+
+    printf("reverbsc storage, threshold %.0f dB\n", -storageThresholdDb);
+
+    reverbBlock.Init(sampleRate);
+    reverbBlock.SetLpFreq(18000.0f);
+    reverbBlock.SetFeedback(0.85f);
+    Timing t = timeBlocks([&](size_t offset, size_t size) {
+        reverbBlock.ProcessBlock(&input[offset], &input[offset], &refLeft[offset], &refRight[offset], size);
+    });
+
+    char label[64];
+    snprintf(label, sizeof(label), "float, %zu KB", sizeof(ReverbSc) / 1024);
+    printTiming(label, t);
+
+    bool pass = benchReverbStorage(reverbInt16, "int16", input, refLeft, refRight);
+    pass = benchReverbStorage(reverbBf16, "bfloat16", input, refLeft, refRight) && pass;
+    return pass;
+}
+
+#define BENCH_MAX_DELAY 120000
+
+static DelayLine<float, BENCH_MAX_DELAY> delayLineLeft, delayLineRight;
+static StereoDelay<StorageFloat, BENCH_MAX_DELAY> delayFloat;
+static StereoDelay<StorageInt16, BENCH_MAX_DELAY> delayInt16;
+
+// Delay time for a sample, jumps every second so the smoothing is exercised
+static float delayTime(size_t i)
+{
+    return (i / 48000) % 2 ? 0.3f * sampleRate : 0.75f * sampleRate;
+}
+
+// Error in dB relative to the reference over the first count samples, or
+// all of them, -inf if the outputs are identical
+static double errorDb(const std::vector<float> &out, const std::vector<float> &ref, size_t count = 0)
+{
+    double error = 0.0, signal = 0.0;
+    size_t size = count > 0 && count < out.size() ? count : out.size();
+    for (size_t i = 0; i < size; i++)
+    {
+        error += (double)(out[i] - ref[i]) * (out[i] - ref[i]);
+        signal += (double)ref[i] * ref[i];
+    }
+    return error > 0.0 ? 10.0 * log10(error / signal) : -INFINITY;
+}
+
+// The engine's delay before StereoDelay, against StereoDelay in float and int16
+static bool benchDelay()
+{
+    std::vector<float> input = testSignal(0.3f, 220.0f);
+    for (size_t i = 0; i < benchSamples; i++)
+    {
+        input[i] = (i / 12000) % 4 ? 0.0f : input[i];
+    }
+
+    printf("stereo delay\n");
+
+    std::vector<float> refLeft(input), refRight(input);
+    {
+        delayLineLeft.Init();
+        delayLineRight.Init();
+        float currentDelay = delayTime(0);
+        Timing t = timeBlocks([&](size_t offset, size_t size) {
+            const float target = delayTime(offset);
+            for (size_t i = offset; i < offset + size; i++)
+            {
+                // fonepole, dsp.h's fmax overloads clash with math.h's here
+                currentDelay += STEREODELAY_SMOOTHING * (target - currentDelay);
+                delayLineLeft.SetDelay(currentDelay);
+                delayLineRight.SetDelay(currentDelay);
+                refLeft[i] += 0.5f * delayLineLeft.Read();
+                refRight[i] += 0.5f * delayLineRight.Read();
+                delayLineLeft.Write(refLeft[i]);
+                delayLineRight.Write(refRight[i]);
+            }
+        });
+        printTiming("DelayLine, fonepole/sample", t);
+    }
+
+    std::vector<float> left(input), right(input);
+    delayFloat.initialize(delayTime(0));
+    Timing t = timeBlocks([&](size_t offset, size_t size) {
+        delayFloat.setDelay(delayTime(offset));
+        delayFloat.processBlock(&left[offset], &right[offset], size);
+    });
+    printTiming("StereoDelay, float", t);
+    // The time first moves after a second, the glide differs from there on
+    double steadyDb = errorDb(left, refLeft, (size_t)sampleRate);
+    char steady[32];
+    snprintf(steady, sizeof(steady), isinf(steadyDb) ? "identical" : "%.1f dB below", -steadyDb);
+    printf("  %-28s %.1f dB below DelayLine, %s before the time first moves\n", "", -errorDb(left, refLeft),
+           steady);
+
+    std::vector<float> left16(input), right16(input);
+    delayInt16.initialize(delayTime(0));
+    t = timeBlocks([&](size_t offset, size_t size) {
+        delayInt16.setDelay(delayTime(offset));
+        delayInt16.processBlock(&left16[offset], &right16[offset], size);
+    });
+    printTiming("StereoDelay, int16", t);
+
+    double db = errorDb(left16, left);
+    bool pass = db < storageThresholdDb;
+    printf("  %-28s error %.1f dB below float: %s\n", "", -db, pass ? "ok" : "FAIL");
+    return pass;
+}
+
+int main(int argc, char **argv)
+{
+    bool all = argc < 2;
+    bool pass = true;
+
+    for (int i = 1; i < argc || all; i++)
+    {
+        const char *name = all ? "all" : argv[i];
+
+        if (all || !strcmp(name, "ladder"))
+        {
+            benchLadder();
+        }
+
+        if (all || !strcmp(name, "oversample"))
+        {
+            benchOversample();
+        }
+
+        if (all || !strcmp(name, "ladderbank"))
+        {
+            benchLadderBank();
+        }
+
+        if (all || !strcmp(name, "modmatrix"))
+        {
+            benchModMatrix();
+        }
+
+        if (all || !strcmp(name, "pitch"))
+        {
+            pass = benchPitch() && pass;
+        }
+
+        if (all || !strcmp(name, "reverb"))
+        {
+            benchReverb();
+        }
+
+        if (all || !strcmp(name, "reverbstorage"))
+        {
+            pass = benchReverbStorage() && pass;
+        }
+
+        if (all || !strcmp(name, "delay"))
+        {
+            pass = benchDelay() && pass;
+        }
+
+        if (all)
+        {
+            break;
+        }
+    }
+
+    return pass ? 0 : 1;
+}
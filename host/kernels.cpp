@@ -0,0 +1,557 @@
+// Kernel timing suite with a JSON baseline.
+//
+// Times each DSP kernel at fixed block sizes and parameter sets and writes
+// the results as JSON. Given a baseline written by an earlier run, it also
+// compares the two and exits with 1 when a kernel got slower than the
+// tolerance allows, so a DSP change can be checked with
+//
+//     build/kernels -c kernels-baseline.json
+//
+// and a new baseline recorded with -o once a change is in. Each kernel is
+// timed several times and the fastest run counts, which keeps scheduler
+// noise out of the comparison. Baselines only compare on the machine and
+// build they were recorded with.
+
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "delayline.h"
+#include "envelopebank.h"
+#include "moogladder.h"
+#include "moogladderbank.h"
+#include "reverbsc.h"
+#include "stereodelay.h"
+#include "synthvoice.h"
+#include "voicebank.h"
+
+using namespace daisysp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const float sampleRate = 48000.0f;
+static const size_t kernelSamples = 48000;
+static const int repeats = 7;
+// Each repeat runs whole passes over kernelSamples for at least this long
+static const double minRepeatNs = 20e6;
+#define KERNELS_MAX_BLOCK 64
+static const size_t blockSizes[] = {16, KERNELS_MAX_BLOCK};
+static const double defaultTolerance = 0.25;
+
+static const char *const profileNames[__P_COUNT] = {"default", "number2", "buzzsaw"};
+
+struct Result
+{
+    std::string name;
+    double ns;
+};
+
+static std::vector<Result> results;
+static std::vector<float> input, output, outputRight;
+// A held note's envelope, for the voice kernels
+static std::vector<float> sustain;
+
+// Times fn(offset, size) over kernelSamples samples in blocks of block,
+// repeats times, and records the fastest as ns per sample
+template <typename Fn>
+static void measure(const std::string &name, size_t block, Fn fn)
+{
+    double best = INFINITY;
+
+    for (int r = 0; r < repeats; r++)
+    {
+        Clock::time_point start = Clock::now();
+        double elapsed = 0.0;
+        size_t samples = 0;
+
+        while (elapsed < minRepeatNs)
+        {
+            for (size_t offset = 0; offset < kernelSamples; offset += block)
+            {
+                fn(offset, block);
+            }
+            samples += kernelSamples;
+            elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        }
+
+        double ns = elapsed / samples;
+        best = ns < best ? ns : best;
+    }
+
+    Result result = {name + "/block" + std::to_string(block), best};
+    results.push_back(result);
+    fprintf(stderr, "  %-40s %8.2f ns/sample\n", result.name.c_str(), best);
+}
+
+// Sawtooth at 0.3, about the level of a few mixed voices
+static void makeInput()
+{
+    input.resize(kernelSamples);
+    output.resize(kernelSamples);
+    outputRight.resize(kernelSamples);
+    sustain.assign(kernelSamples, 0.7f);
+    float phase = 0.0f;
+
+    for (size_t i = 0; i < kernelSamples; i++)
+    {
+        input[i] = 0.3f * (1.0f - 2.0f * phase);
+        phase += 220.0f / sampleRate;
+        phase -= phase >= 1.0f ? 1.0f : 0.0f;
+    }
+}
+
+static WavetableSet wavetables;
+static SynthVoice voices[VOICEBANK_MAX_VOICES];
+static VoiceBank voiceBank;
+
+static void kernelsOscillator(size_t block)
+{
+    const struct
+    {
+        const char *name;
+        uint8_t waveform;
+    } waves[] = {{"sine", Oscillator::WAVE_SIN},
+                 {"saw", Oscillator::WAVE_SAW},
+                 {"polyblep_saw", Oscillator::WAVE_POLYBLEP_SAW}};
+
+    for (size_t w = 0; w < sizeof(waves) / sizeof(waves[0]); w++)
+    {
+        Oscillator osc;
+        osc.Init(sampleRate);
+        osc.SetWaveform(waves[w].waveform);
+        osc.SetFreq(220.0f);
+
+        measure(std::string("oscillator/") + waves[w].name, block, [&](size_t offset, size_t size) {
+            for (size_t i = offset; i < offset + size; i++)
+            {
+                output[i] = osc.Process();
+            }
+        });
+    }
+}
+
+static void kernelsAdsr(size_t block)
+{
+    Adsr envelope;
+    envelope.Init(sampleRate);
+    envelope.SetTime(ADSR_SEG_ATTACK, 0.01f);
+    envelope.SetTime(ADSR_SEG_DECAY, 0.1f);
+    envelope.SetTime(ADSR_SEG_RELEASE, 0.2f);
+    envelope.SetSustainLevel(0.7f);
+
+    // Gate toggles every 100 ms so every segment is in the mix
+    measure("adsr", block, [&](size_t offset, size_t size) {
+        for (size_t i = offset; i < offset + size; i++)
+        {
+            output[i] = envelope.Process((i / 4800) % 2 == 0);
+        }
+    });
+}
+
+// Eight envelopes through the SIMD bank, per sample of all eight. The gates
+// toggle every 100 ms like the adsr kernel's.
+static void kernelsEnvelopeBank(size_t block)
+{
+    const int numVoices = 8;
+    static float buffers[numVoices][KERNELS_MAX_BLOCK];
+    float *out[numVoices];
+    int active[numVoices];
+
+    EnvelopeBank envelopes;
+    envelopes.initialize(sampleRate);
+    envelopes.setTime(ENVELOPE_ATTACK, 0.01f);
+    envelopes.setTime(ENVELOPE_DECAY, 0.1f);
+    envelopes.setTime(ENVELOPE_RELEASE, 0.2f);
+    envelopes.setSustainLevel(0.7f);
+
+    for (int v = 0; v < numVoices; v++)
+    {
+        out[v] = buffers[v];
+        active[v] = v;
+    }
+
+    measure("envelopebank/8voices", block, [&](size_t offset, size_t size) {
+        for (int v = 0; v < numVoices; v++)
+        {
+            if (offset % 9600 == 0)
+            {
+                envelopes.trigger(v);
+            }
+            else if (offset % 9600 == 4800)
+            {
+                envelopes.release(v);
+            }
+        }
+        envelopes.process(out, numVoices, active, numVoices, size);
+    });
+}
+
+static void startVoice(SynthVoice &voice, Profile profile, float frequency)
+{
+    voice.initialize(sampleRate, &wavetables);
+    voice.setProfile(profile);
+    voice.setFrequency(frequency);
+    voice.note = 60;
+}
+
+static void kernelsVoice(size_t block)
+{
+    for (int p = 0; p < __P_COUNT; p++)
+    {
+        Profile profile = static_cast<Profile>(p);
+        std::string name = std::string("voice/") + profileNames[p];
+
+        startVoice(voices[0], profile, 220.0f);
+        measure(name + "/naive", block, [&](size_t offset, size_t size) {
+            voices[0].render(&sustain[offset], &output[offset], size);
+        });
+
+        startVoice(voices[0], profile, 220.0f);
+        voices[0].useWavetables = true;
+        measure(name + "/wavetable", block, [&](size_t offset, size_t size) {
+            voices[0].render(&sustain[offset], &output[offset], size);
+        });
+
+        startVoice(voices[0], profile, 220.0f);
+        voices[0].setUnison(SYNTHVOICE_MAX_UNISON, 0.25f, 1.0f);
+        measure(name + "/unison8", block, [&](size_t offset, size_t size) {
+            voices[0].renderUnison(&sustain[offset], &output[offset], &outputRight[offset], size);
+        });
+    }
+}
+
+// Eight voices through the SIMD bank, per sample of all eight
+static void kernelsVoiceBank(size_t block)
+{
+    const int numVoices = 8;
+    static float buffers[numVoices][KERNELS_MAX_BLOCK];
+    float *out[numVoices];
+    const float *envelopes[numVoices];
+    int active[numVoices];
+
+    for (int p = 0; p < __P_COUNT; p++)
+    {
+        Profile profile = static_cast<Profile>(p);
+        voiceBank.initialize(sampleRate);
+        voiceBank.setProfile(profile);
+
+        for (int v = 0; v < numVoices; v++)
+        {
+            startVoice(voices[v], profile, 110.0f * (v + 1));
+            voiceBank.setVoice(v, voices[v].getFrequency(), voices[v].detune);
+            out[v] = buffers[v];
+            active[v] = v;
+        }
+
+        measure(std::string("voicebank/") + profileNames[p] + "/8voices", block, [&](size_t offset, size_t size) {
+            for (int v = 0; v < numVoices; v++)
+            {
+                envelopes[v] = &sustain[offset];
+            }
+            voiceBank.render(envelopes, out, numVoices, active, numVoices, size);
+        });
+    }
+}
+
+static void kernelsLadder(size_t block)
+{
+    const float resonances[] = {0.0f, 0.5f, 0.9f};
+    const int factors[] = {1, 2, 4};
+
+    for (size_t r = 0; r < sizeof(resonances) / sizeof(resonances[0]); r++)
+    {
+        for (size_t f = 0; f < sizeof(factors) / sizeof(factors[0]); f++)
+        {
+            MoogLadder ladder;
+            ladder.Init(sampleRate);
+            ladder.SetOversampling(factors[f]);
+            ladder.SetFreq(2000.0f);
+            ladder.SetRes(resonances[r]);
+
+            char name[64];
+            snprintf(name, sizeof(name), "moogladder/res%.1f/x%d", resonances[r], factors[f]);
+            measure(name, block, [&](size_t offset, size_t size) {
+                for (size_t i = offset; i < offset + size; i++)
+                {
+                    output[i] = input[i];
+                }
+                ladder.ProcessBlock(&output[offset], size);
+            });
+        }
+    }
+
+    // The per sample entry point the engine used before ProcessBlock
+    MoogLadder ladder;
+    ladder.Init(sampleRate);
+    ladder.SetFreq(2000.0f);
+    ladder.SetRes(0.5f);
+    measure("moogladder/res0.5/process", block, [&](size_t offset, size_t size) {
+        for (size_t i = offset; i < offset + size; i++)
+        {
+            output[i] = ladder.Process(input[i]);
+        }
+    });
+}
+
+// Eight voices, per sample of all eight
+static void kernelsLadderBank(size_t block)
+{
+    const int numVoices = 8;
+    static MoogLadderBank bank;
+    static float buffers[numVoices][KERNELS_MAX_BLOCK];
+    float *out[numVoices];
+    int active[numVoices];
+
+    bank.initialize(sampleRate);
+    for (int v = 0; v < numVoices; v++)
+    {
+        bank.setVoice(v, 500.0f * (v + 1), 0.5f);
+        out[v] = buffers[v];
+        active[v] = v;
+    }
+
+    measure("moogladderbank/res0.5/8voices", block, [&](size_t offset, size_t size) {
+        for (int v = 0; v < numVoices; v++)
+        {
+            memcpy(buffers[v], &input[offset], size * sizeof(float));
+        }
+        bank.process(out, numVoices, active, numVoices, size);
+    });
+}
+
+// Too large for the stack
+static ReverbSc reverb;
+
+static void kernelsReverb(size_t block)
+{
+    const float feedbacks[] = {0.0f, 0.85f, 0.99f};
+
+    for (size_t f = 0; f < sizeof(feedbacks) / sizeof(feedbacks[0]); f++)
+    {
+        reverb.Init(sampleRate);
+        reverb.SetLpFreq(18000.0f);
+        reverb.SetFeedback(feedbacks[f]);
+
+        char name[64];
+        snprintf(name, sizeof(name), "reverbsc/feedback%.2f", feedbacks[f]);
+        measure(std::string(name) + "/process", block, [&](size_t offset, size_t size) {
+            for (size_t i = offset; i < offset + size; i++)
+            {
+                reverb.Process(input[i], input[i], &output[i], &outputRight[i]);
+            }
+        });
+        measure(std::string(name) + "/block", block, [&](size_t offset, size_t size) {
+            reverb.ProcessBlock(&input[offset], &input[offset], &output[offset], &outputRight[offset], size);
+        });
+    }
+}
+
+#define KERNELS_MAX_DELAY 48000
+
+static DelayLine<float, KERNELS_MAX_DELAY> delayLineLeft, delayLineRight;
+static StereoDelay<StorageFloat, KERNELS_MAX_DELAY> delayFloat;
+static StereoDelay<StorageInt16, KERNELS_MAX_DELAY> delayInt16;
+
+// Delay time sweeping between 0.25 and 0.75 s, so the smoothing works
+static float delayTime(size_t i)
+{
+    return sampleRate * (0.5f + 0.25f * sinf(i * (6.2831853f / (2.0f * sampleRate))));
+}
+
+static void kernelsDelay(size_t block)
+{
+    delayLineLeft.Init();
+    delayLineRight.Init();
+    float currentDelay = delayTime(0);
+
+    // How the engine drove DelayLine in getDelaySample
+    measure("delay/delayline", block, [&](size_t offset, size_t size) {
+        const float target = delayTime(offset);
+        for (size_t i = offset; i < offset + size; i++)
+        {
+            currentDelay += STEREODELAY_SMOOTHING * (target - currentDelay);
+            delayLineLeft.SetDelay(currentDelay);
+            delayLineRight.SetDelay(currentDelay);
+            output[i] = input[i] + 0.5f * delayLineLeft.Read();
+            outputRight[i] = input[i] + 0.5f * delayLineRight.Read();
+            delayLineLeft.Write(output[i]);
+            delayLineRight.Write(outputRight[i]);
+        }
+    });
+
+    delayFloat.initialize(delayTime(0));
+    measure("delay/stereodelay_float", block, [&](size_t offset, size_t size) {
+        memcpy(&output[offset], &input[offset], size * sizeof(float));
+        memcpy(&outputRight[offset], &input[offset], size * sizeof(float));
+        delayFloat.setDelay(delayTime(offset));
+        delayFloat.processBlock(&output[offset], &outputRight[offset], size);
+    });
+
+    delayInt16.initialize(delayTime(0));
+    measure("delay/stereodelay_int16", block, [&](size_t offset, size_t size) {
+        memcpy(&output[offset], &input[offset], size * sizeof(float));
+        memcpy(&outputRight[offset], &input[offset], size * sizeof(float));
+        delayInt16.setDelay(delayTime(offset));
+        delayInt16.processBlock(&output[offset], &outputRight[offset], size);
+    });
+}
+
+static bool writeJson(FILE *file)
+{
+    fprintf(file, "{\n  \"unit\": \"ns_per_sample\",\n  \"kernels\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        fprintf(file, "    {\"name\": \"%s\", \"ns\": %.3f}%s\n", results[i].name.c_str(), results[i].ns,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return !ferror(file);
+}
+
+// Reads back what writeJson wrote, one kernel per line, not JSON in general
+static bool readBaseline(const char *path, std::map<std::string, double> &baseline)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    char line[256], name[128];
+    double ns;
+    while (fgets(line, sizeof(line), file))
+    {
+        if (sscanf(line, " {\"name\": \"%127[^\"]\", \"ns\": %lf}", name, &ns) == 2)
+        {
+            baseline[name] = ns;
+        }
+    }
+
+    fclose(file);
+    return !baseline.empty();
+}
+
+// Prints every kernel against the baseline, returns false if any is slower
+// than the tolerance allows
+static bool compare(const std::map<std::string, double> &baseline, double tolerance)
+{
+    int regressions = 0;
+
+    fprintf(stderr, "\n%-46s %10s %10s %8s\n", "kernel", "baseline", "now", "change");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &result = results[i];
+        std::map<std::string, double>::const_iterator it = baseline.find(result.name);
+
+        if (it == baseline.end())
+        {
+            fprintf(stderr, "%-46s %10s %10.2f %8s\n", result.name.c_str(), "-", result.ns, "new");
+            continue;
+        }
+
+        double change = result.ns / it->second - 1.0;
+        bool regressed = change > tolerance;
+        regressions += regressed;
+        fprintf(stderr, "%-46s %10.2f %10.2f %+7.0f%%%s\n", result.name.c_str(), it->second, result.ns,
+                change * 100.0, regressed ? "  REGRESSED" : "");
+    }
+
+    fprintf(stderr, "\n%d of %zu kernels more than %.0f%% slower than the baseline\n", regressions,
+            results.size(), tolerance * 100.0);
+    return regressions == 0;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: kernels [-o results.json] [-c baseline.json] [-t tolerance] [filter]\n"
+            "  -o  write the results there instead of to stdout\n"
+            "  -c  compare against a baseline, exit 1 if a kernel regressed\n"
+            "  -t  allowed slowdown as a fraction, default %.2f\n"
+            "  with a filter only the kernel groups whose name starts with it run\n",
+            defaultTolerance);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *outPath = nullptr;
+    const char *baselinePath = nullptr;
+    const char *filter = "";
+    double tolerance = defaultTolerance;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc)
+        {
+            outPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+        {
+            baselinePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+        {
+            tolerance = atof(argv[++i]);
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage();
+        }
+        else
+        {
+            filter = argv[i];
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselinePath && !readBaseline(baselinePath, baseline))
+    {
+        fprintf(stderr, "kernels: could not read %s\n", baselinePath);
+        return 2;
+    }
+
+    makeInput();
+    wavetables.initialize();
+
+    const struct
+    {
+        const char *name;
+        void (*run)(size_t block);
+    } groups[] = {{"oscillator", kernelsOscillator},     {"adsr", kernelsAdsr},
+                  {"envelopebank", kernelsEnvelopeBank}, {"voice", kernelsVoice},
+                  {"voicebank", kernelsVoiceBank},       {"moogladder", kernelsLadder},
+                  {"moogladderbank", kernelsLadderBank}, {"reverbsc", kernelsReverb},
+                  {"delay", kernelsDelay}};
+
+    for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++)
+    {
+        if (strncmp(groups[g].name, filter, strlen(filter)) != 0)
+        {
+            continue;
+        }
+
+        for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++)
+        {
+            groups[g].run(blockSizes[b]);
+        }
+    }
+
+    FILE *out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out || !writeJson(out))
+    {
+        fprintf(stderr, "kernels: could not write %s\n", outPath ? outPath : "stdout");
+        return 2;
+    }
+    if (outPath)
+    {
+        fclose(out);
+    }
+
+    return baselinePath && !compare(baseline, tolerance) ? 1 : 0;
+}
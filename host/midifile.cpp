@@ -0,0 +1,276 @@
+#include "midifile.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace
+{
+struct TrackEvent
+{
+    uint32_t tick;
+    int order;
+    bool isTempo;
+    uint32_t tempo;
+    uint8_t status;
+    uint8_t data0;
+    uint8_t data1;
+};
+
+uint32_t readBigEndian(const uint8_t *p, int bytes)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+bool readVariableLength(const std::vector<uint8_t> &data, size_t &pos, size_t end, uint32_t &value)
+{
+    value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (pos >= end)
+        {
+            return false;
+        }
+        uint8_t byte = data[pos++];
+        value = (value << 7) | (byte & 0x7f);
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool readTrack(const std::vector<uint8_t> &data, size_t pos, size_t end, std::vector<TrackEvent> &events)
+{
+    uint32_t tick = 0;
+    uint8_t runningStatus = 0;
+
+    while (pos < end)
+    {
+        uint32_t delta;
+        if (!readVariableLength(data, pos, end, delta) || pos >= end)
+        {
+            return false;
+        }
+        tick += delta;
+
+        uint8_t status = data[pos];
+        if (status & 0x80)
+        {
+            pos++;
+        }
+        else if (runningStatus)
+        {
+            status = runningStatus;
+        }
+        else
+        {
+            return false;
+        }
+
+        if (status == 0xff)
+        {
+            if (pos >= end)
+            {
+                return false;
+            }
+            uint8_t type = data[pos++];
+            uint32_t length;
+            if (!readVariableLength(data, pos, end, length) || pos + length > end)
+            {
+                return false;
+            }
+            if (type == 0x51 && length == 3)
+            {
+                TrackEvent e = {tick, (int)events.size(), true, readBigEndian(&data[pos], 3), 0, 0, 0};
+                events.push_back(e);
+            }
+            else if (type == 0x2f)
+            {
+                return true;
+            }
+            pos += length;
+        }
+        else if (status == 0xf0 || status == 0xf7)
+        {
+            uint32_t length;
+            if (!readVariableLength(data, pos, end, length) || pos + length > end)
+            {
+                return false;
+            }
+            pos += length;
+        }
+        else
+        {
+            runningStatus = status;
+            int dataBytes = ((status & 0xf0) == 0xc0 || (status & 0xf0) == 0xd0) ? 1 : 2;
+            if (pos + dataBytes > end)
+            {
+                return false;
+            }
+            TrackEvent e = {tick, (int)events.size(), false, 0, status, data[pos], 0};
+            if (dataBytes == 2)
+            {
+                e.data1 = data[pos + 1];
+            }
+            pos += dataBytes;
+            events.push_back(e);
+        }
+    }
+
+    return true;
+}
+} // namespace
+
+bool readMidiFile(const std::string &path, std::vector<TimedMidiEvent> &events)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() < 14 || std::string(data.begin(), data.begin() + 4) != "MThd")
+    {
+        return false;
+    }
+
+    uint32_t headerLength = readBigEndian(&data[4], 4);
+    int numTracks = readBigEndian(&data[10], 2);
+    uint16_t division = readBigEndian(&data[12], 2);
+
+    // Seconds per tick at the default 120 bpm, or fixed for SMPTE timing
+    bool smpte = division & 0x8000;
+    double ticksPerUnit = division;
+    if (smpte)
+    {
+        int framesPerSecond = -static_cast<int8_t>(division >> 8);
+        ticksPerUnit = framesPerSecond * (division & 0xff);
+    }
+
+    std::vector<TrackEvent> merged;
+    size_t pos = 8 + headerLength;
+
+    for (int track = 0; track < numTracks && pos + 8 <= data.size(); track++)
+    {
+        uint32_t length = readBigEndian(&data[pos + 4], 4);
+        size_t start = pos + 8;
+        size_t end = std::min(data.size(), start + length);
+
+        if (std::string(data.begin() + pos, data.begin() + pos + 4) == "MTrk")
+        {
+            std::vector<TrackEvent> trackEvents;
+            if (!readTrack(data, start, end, trackEvents))
+            {
+                return false;
+            }
+            for (size_t i = 0; i < trackEvents.size(); i++)
+            {
+                trackEvents[i].order = (int)merged.size();
+                merged.push_back(trackEvents[i]);
+            }
+        }
+
+        pos = end;
+    }
+
+    std::stable_sort(merged.begin(), merged.end(), [](const TrackEvent &a, const TrackEvent &b) {
+        return a.tick < b.tick;
+    });
+
+    double seconds = 0.0;
+    double tempo = 500000.0;
+    uint32_t lastTick = 0;
+
+    events.clear();
+    for (size_t i = 0; i < merged.size(); i++)
+    {
+        const TrackEvent &e = merged[i];
+        double ticks = e.tick - lastTick;
+        seconds += smpte ? ticks / ticksPerUnit : ticks * tempo / (1000000.0 * ticksPerUnit);
+        lastTick = e.tick;
+
+        if (e.isTempo)
+        {
+            tempo = e.tempo;
+            continue;
+        }
+
+        TimedMidiEvent timed = {seconds, e.status, e.data0, e.data1};
+        events.push_back(timed);
+    }
+
+    return true;
+}
+
+bool readEventScript(const std::string &path, std::vector<TimedMidiEvent> &events)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        return false;
+    }
+
+    events.clear();
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream in(line);
+        double seconds;
+        std::string type;
+
+        if (line.empty() || line[0] == '#' || !(in >> seconds >> type))
+        {
+            continue;
+        }
+
+        int a = 0, b = 0;
+        TimedMidiEvent e = {seconds, 0, 0, 0};
+
+        if (type == "on" && (in >> a))
+        {
+            if (!(in >> b))
+            {
+                b = 100;
+            }
+            e.status = 0x90;
+        }
+        else if (type == "off" && (in >> a))
+        {
+            e.status = 0x80;
+        }
+        else if (type == "cc" && (in >> a >> b))
+        {
+            e.status = 0xb0;
+        }
+        else if (type == "bend" && (in >> a))
+        {
+            // -8192 to 8191, split into the two 7 bit halves
+            a += 8192;
+            b = a >> 7;
+            e.status = 0xe0;
+        }
+        else
+        {
+            return false;
+        }
+
+        e.data0 = a & 0x7f;
+        e.data1 = b & 0x7f;
+        events.push_back(e);
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const TimedMidiEvent &a, const TimedMidiEvent &b) {
+        return a.seconds < b.seconds;
+    });
+
+    return true;
+}
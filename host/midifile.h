@@ -0,0 +1,28 @@
+#ifndef MIDIFILE_H
+#define MIDIFILE_H
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// A channel message and its time in seconds from the start of the song
+struct TimedMidiEvent
+{
+    double seconds;
+    uint8_t status;
+    uint8_t data0;
+    uint8_t data1;
+};
+
+// Reads a Standard MIDI File (format 0 or 1), merging all tracks into one
+// time ordered list of channel messages.
+bool readMidiFile(const std::string &path, std::vector<TimedMidiEvent> &events);
+
+// Reads a plain text event script with one event per line:
+//   <seconds> on <note> [velocity]
+//   <seconds> off <note>
+//   <seconds> cc <control> <value>
+//   <seconds> bend <value>, -8192 to 8191
+// Blank lines and lines starting with # are ignored.
+bool readEventScript(const std::string &path, std::vector<TimedMidiEvent> &events);
+
+#endif // MIDIFILE_H
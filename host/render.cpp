@@ -0,0 +1,249 @@
+// Offline renderer for the synth engine.
+//
+// Plays a Standard MIDI File or a text event script through SynthEngine,
+// writes the result to a WAV file and reports how long each stage of the
+// audio chain took.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "midifile.h"
+#include "synthengine.h"
+#include "threadpool.h"
+#include "wavfile.h"
+
+static EngineMemory engineMemory;
+static SynthEngine engine;
+static LoadMeter loadMeter;
+static DenormalCounter denormalCounter;
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: render [-r sample_rate] [-b block_size (max %d)] [-t tail_seconds] [-s] [-f]\n"
+            "              [-o oversampling] [-g load_scale] [-j threads] [-d] <song.mid|events.txt> <out.wav>\n"
+            "  -s  render voices one SynthVoice at a time instead of through the VoiceBank\n"
+            "  -f  filter each voice on its own instead of the mix\n"
+            "  -o  run the global filter at 1, 2 or 4 times the sample rate\n"
+            "  -g  govern polyphony by the measured load times load_scale, which stands\n"
+            "      in for how much slower the target CPU is\n"
+            "  -j  render voices on this many threads, the output does not change\n"
+            "  -d  count the subnormals left in each stage's state, with flush-to-zero off\n",
+            SYNTH_MAX_BLOCK);
+    exit(1);
+}
+
+static bool endsWith(const std::string &s, const char *suffix)
+{
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+static EngineEvent toEngineEvent(const TimedMidiEvent &e, float sampleRate)
+{
+    EngineEvent event;
+    event.time = (uint32_t)(e.seconds * sampleRate + 0.5);
+    event.status = e.status;
+    event.data0 = e.data0;
+    event.data1 = e.data1;
+    return event;
+}
+
+int main(int argc, char **argv)
+{
+    float sampleRate = 48000.0f;
+    size_t blockSize = 16;
+    double tail = 2.0;
+    bool scalarVoices = false;
+    bool perVoiceFilter = false;
+    int oversampling = SYNTH_FILTER_OVERSAMPLING;
+    float loadScale = 0.0f;
+    int threads = 1;
+    bool countDenormals = false;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc)
+        {
+            sampleRate = (float)atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+        {
+            blockSize = (size_t)atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+        {
+            tail = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-s"))
+        {
+            scalarVoices = true;
+        }
+        else if (!strcmp(argv[i], "-f"))
+        {
+            perVoiceFilter = true;
+        }
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+        {
+            oversampling = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-g") && i + 1 < argc)
+        {
+            loadScale = (float)atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-d"))
+        {
+            countDenormals = true;
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage();
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.size() != 2 || threads < 1 || blockSize == 0 || blockSize > SYNTH_MAX_BLOCK || sampleRate <= 0.0f)
+    {
+        usage();
+    }
+
+    std::vector<TimedMidiEvent> events;
+    bool isMidiFile = endsWith(paths[0], ".mid") || endsWith(paths[0], ".midi");
+    if (!(isMidiFile ? readMidiFile(paths[0], events) : readEventScript(paths[0], events)))
+    {
+        fprintf(stderr, "render: could not read %s\n", paths[0].c_str());
+        return 1;
+    }
+
+    double songSeconds = events.empty() ? 0.0 : events.back().seconds;
+    size_t frames = (size_t)((songSeconds + tail) * sampleRate);
+
+    engine.initialize(sampleRate, &engineMemory);
+    engine.useVoiceBank = !scalarVoices;
+    engine.setPerVoiceFilter(perVoiceFilter);
+    engine.setFilterOversampling(oversampling);
+    ThreadPool pool(threads);
+    engine.jobRunner = &pool;
+    engine.loadMeter = &loadMeter;
+    engine.denormalCounter = countDenormals ? &denormalCounter : nullptr;
+    // Under flush-to-zero no state can go subnormal, so counting turns it off
+    engine.flushDenormals = !countDenormals;
+    loadMeter.initialize(sampleRate);
+
+    std::vector<float> left(frames), right(frames);
+    size_t nextEvent = 0;
+
+    // Each block's events are queued before it renders, the way the firmware's
+    // MIDI loop queues them while the previous block plays. The engine splits
+    // the block at their sample times.
+    for (size_t start = 0; start < frames; start += blockSize)
+    {
+        size_t end = frames - start < blockSize ? frames : start + blockSize;
+
+        while (nextEvent < events.size())
+        {
+            EngineEvent event = toEngineEvent(events[nextEvent], sampleRate);
+            if (event.time >= end || !engine.postEvent(event))
+            {
+                break;
+            }
+            nextEvent++;
+        }
+
+        loadMeter.beginBlock();
+        engine.process(&left[start], &right[start], end - start);
+        loadMeter.endBlock(end - start);
+        if (loadScale > 0.0f)
+        {
+            engine.updateVoiceLimit(loadMeter.getLoad() * loadScale,
+                                    loadMeter.getStageLoad(LOAD_VOICES) * loadScale);
+        }
+    }
+
+    if (!writeWavFile(paths[1], left.data(), right.data(), frames, (int)sampleRate))
+    {
+        fprintf(stderr, "render: could not write %s\n", paths[1].c_str());
+        return 1;
+    }
+
+    // The host counter counts nanoseconds
+    double audioNs = frames / sampleRate * 1e9;
+    double stageNs[__LOAD_STAGE_COUNT];
+    double blocks = loadMeter.getBlocks();
+
+    printf("rendered %.2f s (%zu samples) at %.0f Hz, block size %zu, %zu events, %d voices on %d threads\n\n",
+           frames / sampleRate, frames, sampleRate, blockSize, events.size(), POLYSYNTH_VOICES, threads);
+    printf("%-8s %12s %18s %27s\n", "stage", "ns/sample", "real-time factor", "ns/block min/avg/max");
+
+    for (int s = LOAD_EVENTS; s < __LOAD_STAGE_COUNT; s++)
+    {
+        const LoadStats &stats = loadMeter.getStats(s);
+        stageNs[s] = (double)stats.sum;
+        printf("%-8s %12.1f %18.1f %9u/%8.0f/%8u\n", s == LOAD_BLOCK ? "total" : loadStageNames[s],
+               stageNs[s] / frames, audioNs / stageNs[s], (unsigned)stats.min, stageNs[s] / blocks,
+               (unsigned)stats.max);
+    }
+
+    // Block time as a share of the block's duration
+    const uint32_t *histogram = loadMeter.getHistogram();
+    printf("\nblock load  ");
+    for (int b = 0; b < LOADMETER_BUCKETS; b++)
+    {
+        if (histogram[b] > 0)
+        {
+            printf(" %g%%:%u", b * LOADMETER_BUCKET_WIDTH * 100.0f, (unsigned)histogram[b]);
+        }
+    }
+    printf("\npeak load %.2f%%, %u overruns\n\n", loadMeter.getPeakLoad() * 100.0f,
+           (unsigned)loadMeter.getOverruns());
+
+    // Idle voices are skipped, so the voice stage scales with the active count
+    double activeVoiceSamples = (double)loadMeter.getVoiceSamples();
+    double voiceNs = activeVoiceSamples > 0.0 ? stageNs[LOAD_VOICES] / activeVoiceSamples : 0.0;
+    double fixedNs = (stageNs[LOAD_BLOCK] - stageNs[LOAD_VOICES]) / frames;
+    double budgetNs = 1e9 / sampleRate;
+    printf("%.2f active voices on average\n", activeVoiceSamples / frames);
+    if (voiceNs > 0.0)
+    {
+        printf("%.1f ns per active voice per sample, %.0f voices fit in the %.1f ns/sample budget\n",
+               voiceNs, (budgetNs - fixedNs) / voiceNs, budgetNs);
+    }
+
+    if (countDenormals)
+    {
+        printf("subnormal state values");
+        for (int s = LOAD_VOICES; s <= LOAD_DELAY; s++)
+        {
+            printf(" %s:%u in %u blocks", loadStageNames[s], (unsigned)denormalCounter.getValues(s),
+                   (unsigned)denormalCounter.getBlocks(s));
+        }
+        printf("\n");
+    }
+
+    const VoiceAllocatorStats &stats = engine.allocator.getStats();
+    printf("%u notes, %u retriggered, %u stolen from released voices, %u from held voices\n",
+           (unsigned)stats.notes, (unsigned)stats.retriggers,
+           (unsigned)stats.releasedSteals, (unsigned)stats.heldSteals);
+    if (threads > 1)
+    {
+        printf("%lu voice jobs stolen between threads\n", pool.getSteals());
+    }
+    if (loadScale > 0.0f)
+    {
+        printf("voice limit %d, lowest %d after %u cuts, %u voices shed\n", engine.governor.getLimit(),
+               engine.governor.getLowestLimit(), (unsigned)engine.governor.getCuts(), (unsigned)stats.shed);
+    }
+
+    return 0;
+}
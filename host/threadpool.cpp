@@ -0,0 +1,103 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int threads)
+    : ranges_(threads < 1 ? 1 : threads), generation_(0), busyWorkers_(0), stop_(false), steals_(0)
+{
+    for (size_t t = 0; t < ranges_.size(); t++)
+    {
+        ranges_[t].next.store(0);
+        ranges_[t].end = 0;
+    }
+
+    for (size_t t = 1; t < ranges_.size(); t++)
+    {
+        workers_.emplace_back(&ThreadPool::workerLoop, this, (int)t);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop_.store(true, std::memory_order_release);
+
+    for (size_t t = 0; t < workers_.size(); t++)
+    {
+        workers_[t].join();
+    }
+}
+
+void ThreadPool::run(int count, Job job, void *context)
+{
+    int threads = (int)ranges_.size();
+
+    if (threads == 1 || count < 2)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            job(context, i);
+        }
+        return;
+    }
+
+    job_ = job;
+    context_ = context;
+
+    for (int t = 0; t < threads; t++)
+    {
+        ranges_[t].next.store(count * t / threads, std::memory_order_relaxed);
+        ranges_[t].end = count * (t + 1) / threads;
+    }
+
+    // The release publishes the job and the ranges to the workers
+    busyWorkers_.store(threads - 1, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_release);
+
+    work(0);
+
+    // Workers may still be looking for jobs to steal, which must be over
+    // before the next run() deals new ranges
+    while (busyWorkers_.load(std::memory_order_acquire) > 0)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void ThreadPool::work(int self)
+{
+    int threads = (int)ranges_.size();
+
+    for (int i = 0; i < threads; i++)
+    {
+        int t = (self + i) % threads;
+        Range &range = ranges_[t];
+
+        for (int j = range.next.fetch_add(1, std::memory_order_relaxed); j < range.end;
+             j = range.next.fetch_add(1, std::memory_order_relaxed))
+        {
+            job_(context_, j);
+            if (t != self)
+            {
+                steals_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void ThreadPool::workerLoop(int self)
+{
+    unsigned seen = 0;
+
+    while (!stop_.load(std::memory_order_acquire))
+    {
+        unsigned generation = generation_.load(std::memory_order_acquire);
+
+        if (generation == seen)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        seen = generation;
+        work(self);
+        busyWorkers_.fetch_sub(1, std::memory_order_release);
+    }
+}
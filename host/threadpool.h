@@ -0,0 +1,57 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "jobrunner.h"
+
+#define THREADPOOL_CACHE_LINE 64
+
+// JobRunner over a fixed set of worker threads, host builds only.
+//
+// run() deals the jobs out in equal contiguous ranges, one per thread with
+// the calling thread taking the first. A thread that finishes its range
+// steals single jobs from the others' ranges, so uneven jobs still keep
+// every thread busy. Workers spin between batches instead of sleeping,
+// since a batch is one audio block and a wakeup would cost more than it.
+class ThreadPool : public JobRunner
+{
+public:
+    // threads counts the calling thread, 1 runs everything inline
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    int getThreads() const { return (int)ranges_.size(); }
+    // Jobs that ran on another thread than the range they were dealt to
+    unsigned long getSteals() const { return steals_.load(std::memory_order_relaxed); }
+
+    void run(int count, Job job, void *context) override;
+
+private:
+    // Padded so threads taking jobs from different ranges don't share a
+    // line. Padding rather than alignas, which std::vector does not honour
+    // before C++17: one line apart, the 8 bytes each range uses never share
+    // a line wherever the vector's storage starts.
+    struct Range
+    {
+        std::atomic<int> next;
+        int end;
+        char pad[THREADPOOL_CACHE_LINE - sizeof(std::atomic<int>) - sizeof(int)];
+    };
+
+    std::vector<Range> ranges_;
+    std::vector<std::thread> workers_;
+
+    Job job_;
+    void *context_;
+    std::atomic<unsigned> generation_;
+    std::atomic<int> busyWorkers_;
+    std::atomic<bool> stop_;
+    std::atomic<unsigned long> steals_;
+
+    void work(int self);
+    void workerLoop(int self);
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,59 @@
+#include "wavfile.h"
+#include <stdint.h>
+#include <stdio.h>
+
+namespace
+{
+void writeU32(FILE *file, uint32_t value)
+{
+    uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    fwrite(bytes, 1, 4, file);
+}
+
+void writeU16(FILE *file, uint16_t value)
+{
+    uint8_t bytes[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+    fwrite(bytes, 1, 2, file);
+}
+} // namespace
+
+bool writeWavFile(const std::string &path,
+                  const float *left,
+                  const float *right,
+                  size_t frames,
+                  int sampleRate)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    const uint16_t channels = 2;
+    const uint16_t bitsPerSample = 32;
+    const uint32_t dataBytes = (uint32_t)(frames * channels * sizeof(float));
+
+    fwrite("RIFF", 1, 4, file);
+    writeU32(file, 36 + dataBytes);
+    fwrite("WAVE", 1, 4, file);
+
+    fwrite("fmt ", 1, 4, file);
+    writeU32(file, 16);
+    writeU16(file, 3); // IEEE float
+    writeU16(file, channels);
+    writeU32(file, sampleRate);
+    writeU32(file, sampleRate * channels * bitsPerSample / 8);
+    writeU16(file, channels * bitsPerSample / 8);
+    writeU16(file, bitsPerSample);
+
+    fwrite("data", 1, 4, file);
+    writeU32(file, dataBytes);
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        float frame[2] = {left[i], right[i]};
+        fwrite(frame, sizeof(float), 2, file);
+    }
+
+    return fclose(file) == 0;
+}
@@ -0,0 +1,13 @@
+#ifndef WAVFILE_H
+#define WAVFILE_H
+#include <stddef.h>
+#include <string>
+
+// Writes a stereo 32-bit float WAV file
+bool writeWavFile(const std::string &path,
+                  const float *left,
+                  const float *right,
+                  size_t frames,
+                  int sampleRate);
+
+#endif // WAVFILE_H
@@ -0,0 +1,18 @@
+#ifndef JOBRUNNER_H
+#define JOBRUNNER_H
+
+// Runs a batch of independent jobs, on other threads if it has any.
+// run() returns once every job is done. The firmware has none and the
+// engine runs its jobs inline; host builds can plug in a thread pool.
+class JobRunner
+{
+public:
+    typedef void (*Job)(void *context, int index);
+
+    virtual ~JobRunner() {}
+
+    // Calls job(context, i) once for each i in [0, count)
+    virtual void run(int count, Job job, void *context) = 0;
+};
+
+#endif // JOBRUNNER_H
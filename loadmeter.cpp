@@ -0,0 +1,120 @@
+#include "loadmeter.h"
+
+const char *const loadStageNames[__LOAD_STAGE_COUNT] = {
+    "controls", "events", "voices", "filter", "reverb", "delay", "block"};
+
+LoadMeter::LoadMeter() {}
+LoadMeter::~LoadMeter() {}
+
+void LoadMeter::initialize(float sampleRate)
+{
+    sampleRate_ = sampleRate;
+    cyclesPerSample_ = cycleCounterHz() / sampleRate;
+    reset();
+}
+
+void LoadMeter::reset()
+{
+    blockStart_ = last_ = cycleCount();
+    blocks_ = 0;
+    overruns_ = 0;
+    voiceSamples_ = 0;
+    load_ = recentLoad_ = peakLoad_ = 0.0f;
+    lastBudget_ = 1.0f;
+
+    for (int s = 0; s < __LOAD_STAGE_COUNT; s++)
+    {
+        current_[s] = 0;
+        lastCycles_[s] = 0;
+        stats_[s].min = UINT32_MAX;
+        stats_[s].max = 0;
+        stats_[s].sum = 0;
+    }
+
+    for (int b = 0; b < LOADMETER_BUCKETS; b++)
+    {
+        histogram_[b] = 0;
+    }
+}
+
+void LoadMeter::endBlock(size_t size)
+{
+    uint32_t total = cycleCount() - blockStart_;
+    current_[LOAD_BLOCK] = total;
+
+    for (int s = 0; s < __LOAD_STAGE_COUNT; s++)
+    {
+        uint32_t cycles = current_[s];
+        LoadStats &stats = stats_[s];
+
+        stats.min = cycles < stats.min ? cycles : stats.min;
+        stats.max = cycles > stats.max ? cycles : stats.max;
+        stats.sum += cycles;
+        lastCycles_[s] = cycles;
+        current_[s] = 0;
+    }
+
+    lastBudget_ = cyclesPerSample_ * size;
+    load_ = total / lastBudget_;
+    recentLoad_ += (load_ - recentLoad_) * LOADMETER_RECENT_SMOOTHING;
+    peakLoad_ = load_ > peakLoad_ ? load_ : peakLoad_;
+
+    int bucket = (int)(load_ * (1.0f / LOADMETER_BUCKET_WIDTH));
+    histogram_[bucket < LOADMETER_BUCKETS ? bucket : LOADMETER_BUCKETS - 1]++;
+
+    if (load_ > 1.0f)
+    {
+        overruns_++;
+    }
+    blocks_++;
+}
+
+// 32 bit values go out as five 7 bit bytes, least significant first
+static uint8_t *writeValue(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 5; i++)
+    {
+        *out++ = value & 0x7f;
+        value >>= 7;
+    }
+    return out;
+}
+
+size_t LoadMeter::writeSysex(uint8_t *out, size_t maxSize) const
+{
+    // Counter rate, sample rate, blocks, overruns, min/avg/max per stage,
+    // then the histogram
+    const size_t values = 4 + 3 * __LOAD_STAGE_COUNT + LOADMETER_BUCKETS;
+    const size_t size = 4 + 5 * values;
+
+    if (maxSize < size)
+    {
+        return 0;
+    }
+
+    uint8_t *p = out;
+    *p++ = 0xf0;
+    *p++ = LOADMETER_SYSEX_ID;
+    *p++ = LOADMETER_SYSEX_DUMP;
+
+    p = writeValue(p, (uint32_t)cycleCounterHz());
+    p = writeValue(p, (uint32_t)sampleRate_);
+    p = writeValue(p, blocks_);
+    p = writeValue(p, overruns_);
+
+    for (int s = 0; s < __LOAD_STAGE_COUNT; s++)
+    {
+        const LoadStats &stats = stats_[s];
+        p = writeValue(p, blocks_ > 0 ? stats.min : 0);
+        p = writeValue(p, blocks_ > 0 ? (uint32_t)(stats.sum / blocks_) : 0);
+        p = writeValue(p, stats.max);
+    }
+
+    for (int b = 0; b < LOADMETER_BUCKETS; b++)
+    {
+        p = writeValue(p, histogram_[b]);
+    }
+
+    *p++ = 0xf7;
+    return p - out;
+}
@@ -0,0 +1,124 @@
+#ifndef LOADMETER_H
+#define LOADMETER_H
+#include <stddef.h>
+#include <stdint.h>
+#include "cyclecounter.h"
+
+#define LOADMETER_BUCKETS 16
+// Each histogram bucket covers this fraction of the block's time budget,
+// the last one also counts everything above
+#define LOADMETER_BUCKET_WIDTH 0.125f
+// Per-block coefficient of getRecentLoad's smoothing
+#define LOADMETER_RECENT_SMOOTHING 0.01f
+
+// SysEx, after the 0x7d non-commercial manufacturer ID.
+// F0 7D 01 F7 asks for a dump, which comes back as F0 7D 02 <values> F7.
+#define LOADMETER_SYSEX_ID 0x7d
+#define LOADMETER_SYSEX_REQUEST 0x01
+#define LOADMETER_SYSEX_DUMP 0x02
+#define LOADMETER_SYSEX_SIZE 256
+
+enum LoadStage
+{
+    // Work in the callback before the engine runs. The firmware services
+    // its controls from the main loop, so there this is just bookkeeping.
+    LOAD_CONTROLS,
+    // Event dispatch and parameter updates
+    LOAD_EVENTS,
+    LOAD_VOICES,
+    LOAD_FILTER,
+    LOAD_REVERB,
+    LOAD_DELAY,
+    // The whole block, from beginBlock to endBlock
+    LOAD_BLOCK,
+    __LOAD_STAGE_COUNT
+};
+
+extern const char *const loadStageNames[__LOAD_STAGE_COUNT];
+
+// Counter cycles a stage took per block
+struct LoadStats
+{
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+};
+
+// Times the stages of each audio block with cycleCount(). mark() charges the
+// time since the previous mark to a stage, so stages that run more than once
+// per block add up. endBlock() folds the block into min/avg/max per stage and
+// a histogram of block time as a fraction of the block's duration.
+//
+// Only the audio thread writes, other threads read the counters without
+// locking, so a read can mix two blocks.
+class LoadMeter
+{
+public:
+    LoadMeter();
+    ~LoadMeter();
+
+    void initialize(float sampleRate);
+    void reset();
+
+    void beginBlock()
+    {
+        blockStart_ = last_ = cycleCount();
+    }
+
+    void mark(int stage)
+    {
+        uint32_t now = cycleCount();
+        current_[stage] += now - last_;
+        last_ = now;
+    }
+
+    void endBlock(size_t size);
+
+    // Counts the voices the voice stage renders for a stretch of size
+    // samples, so its time can be put per voice
+    void addVoiceSamples(int voices, size_t size)
+    {
+        voiceSamples_ += (uint64_t)voices * size;
+    }
+
+    uint32_t getBlocks() const { return blocks_; }
+    // Blocks that took longer than they last
+    uint32_t getOverruns() const { return overruns_; }
+    const LoadStats &getStats(int stage) const { return stats_[stage]; }
+    const uint32_t *getHistogram() const { return histogram_; }
+
+    // Fractions of the time budget, 1 is a block that took as long as it lasts
+    float getLoad() const { return load_; }
+    float getRecentLoad() const { return recentLoad_; }
+    float getPeakLoad() const { return peakLoad_; }
+    // Share of the last block's time budget one stage took
+    float getStageLoad(int stage) const { return lastCycles_[stage] / lastBudget_; }
+
+    float getCyclesPerSample() const { return cyclesPerSample_; }
+    // Sum over the samples processed of the voices active for each
+    uint64_t getVoiceSamples() const { return voiceSamples_; }
+
+    // Writes the SysEx dump to out and returns its length, or 0 if it
+    // does not fit
+    size_t writeSysex(uint8_t *out, size_t maxSize) const;
+
+private:
+    float sampleRate_;
+    float cyclesPerSample_;
+    uint32_t blockStart_;
+    uint32_t last_;
+    uint32_t current_[__LOAD_STAGE_COUNT];
+    uint32_t lastCycles_[__LOAD_STAGE_COUNT];
+    float lastBudget_;
+
+    uint32_t blocks_;
+    uint32_t overruns_;
+    uint64_t voiceSamples_;
+    LoadStats stats_[__LOAD_STAGE_COUNT];
+    uint32_t histogram_[LOADMETER_BUCKETS];
+    float load_;
+    float recentLoad_;
+    float peakLoad_;
+};
+
+#endif // LOADMETER_H
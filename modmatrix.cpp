@@ -0,0 +1,156 @@
+#include "modmatrix.h"
+#include "waveshape.h"
+
+const float modDestinationRange[__MOD_DESTINATION_COUNT] = {
+    12.0f, // MOD_PITCH
+    4.0f,  // MOD_CUTOFF
+    1.0f,  // MOD_AMPLITUDE
+    1.0f,  // MOD_DETUNE
+};
+
+ModMatrix::ModMatrix() {}
+ModMatrix::~ModMatrix() {}
+
+void ModMatrix::initialize(float sampleRate)
+{
+    sampleRateRecip_ = 1.0f / sampleRate;
+
+    for (int r = 0; r < MODMATRIX_ROUTES; r++)
+    {
+        setRoute(r, MOD_LFO1, MOD_PITCH, 0.0f);
+    }
+
+    for (int l = 0; l < MODMATRIX_GLOBAL_LFOS; l++)
+    {
+        lfoPhase_[l] = 0.0f;
+        lfoInc_[l] = 0.0f;
+    }
+    for (int v = 0; v < MODMATRIX_MAX_VOICES; v++)
+    {
+        voicePhase_[v] = 0.0f;
+    }
+    voiceInc_ = 0.0f;
+
+    compile();
+}
+
+void ModMatrix::setRoute(int slot, int source, int destination, float amount)
+{
+    if (slot < 0 || slot >= MODMATRIX_ROUTES || source < 0 || source >= __MOD_SOURCE_COUNT || destination < 0
+        || destination >= __MOD_DESTINATION_COUNT)
+    {
+        return;
+    }
+
+    ModRoute &route = routes_[slot];
+    route.source = source;
+    route.destination = destination;
+    route.amount = amount < -1.0f ? -1.0f : (amount > 1.0f ? 1.0f : amount);
+    dirty_ = true;
+}
+
+void ModMatrix::setLfoRate(int lfo, float rate)
+{
+    if (lfo == MOD_VOICE_LFO)
+    {
+        voiceInc_ = rate * sampleRateRecip_;
+    }
+    else if (lfo >= 0 && lfo < MODMATRIX_GLOBAL_LFOS)
+    {
+        lfoInc_[lfo] = rate * sampleRateRecip_;
+    }
+}
+
+void ModMatrix::compile()
+{
+    numGlobal_ = numVoice_ = 0;
+    routed_ = 0;
+    voiceLfoUsed_ = false;
+
+    for (int r = 0; r < MODMATRIX_ROUTES; r++)
+    {
+        const ModRoute &route = routes_[r];
+        if (route.amount == 0.0f)
+        {
+            continue;
+        }
+
+        float amount = route.amount * modDestinationRange[route.destination];
+        routed_ |= 1u << route.destination;
+
+        if (route.source < MODMATRIX_GLOBAL_LFOS)
+        {
+            globalSource_[numGlobal_] = route.source;
+            globalDestination_[numGlobal_] = route.destination;
+            globalAmount_[numGlobal_] = amount;
+            numGlobal_++;
+        }
+        else
+        {
+            voiceSource_[numVoice_] = route.source;
+            voiceDestination_[numVoice_] = route.destination;
+            voiceAmount_[numVoice_] = amount;
+            voiceLfoUsed_ |= route.source == MOD_VOICE_LFO;
+            numVoice_++;
+        }
+    }
+
+    dirty_ = false;
+}
+
+void ModMatrix::beginBlock(size_t size)
+{
+    if (dirty_)
+    {
+        compile();
+    }
+
+    float sources[MODMATRIX_GLOBAL_LFOS];
+    for (int l = 0; l < MODMATRIX_GLOBAL_LFOS; l++)
+    {
+        sources[l] = WaveShape<SINE>::sample(lfoPhase_[l]);
+        lfoPhase_[l] += lfoInc_[l] * size;
+        lfoPhase_[l] -= (int)lfoPhase_[l];
+    }
+
+    for (int d = 0; d < __MOD_DESTINATION_COUNT; d++)
+    {
+        global_[d] = 0.0f;
+    }
+    for (int r = 0; r < numGlobal_; r++)
+    {
+        global_[globalDestination_[r]] += globalAmount_[r] * sources[globalSource_[r]];
+    }
+}
+
+void ModMatrix::evaluate(int voice, float envelope, float velocity, size_t size, float *out)
+{
+    for (int d = 0; d < __MOD_DESTINATION_COUNT; d++)
+    {
+        out[d] = global_[d];
+    }
+
+    if (numVoice_ == 0)
+    {
+        return;
+    }
+
+    // Indexed by source, the global slots are unused here
+    float sources[__MOD_SOURCE_COUNT];
+    sources[MOD_VOICE_LFO] = 0.0f;
+    sources[MOD_ENVELOPE] = envelope;
+    sources[MOD_VELOCITY] = velocity;
+
+    if (voiceLfoUsed_)
+    {
+        float &phase = voicePhase_[voice];
+        sources[MOD_VOICE_LFO] = WaveShape<SINE>::sample(phase);
+        phase += voiceInc_ * size;
+        phase -= (int)phase;
+    }
+
+    for (int r = 0; r < numVoice_; r++)
+    {
+        out[voiceDestination_[r]] += voiceAmount_[r] * sources[voiceSource_[r]];
+    }
+}
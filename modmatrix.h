@@ -0,0 +1,104 @@
+#ifndef MODMATRIX_H
+#define MODMATRIX_H
+#include <stddef.h>
+#include <stdint.h>
+
+#define MODMATRIX_ROUTES 8
+#define MODMATRIX_MAX_VOICES 64
+#define MODMATRIX_GLOBAL_LFOS 2
+
+enum ModSource
+{
+    // Shared by all voices, computed once per block
+    MOD_LFO1,
+    MOD_LFO2,
+    // Per voice: an LFO restarted by each note, the voice envelope and
+    // the note's velocity, all 0 to 1 except the LFOs' -1 to 1
+    MOD_VOICE_LFO,
+    MOD_ENVELOPE,
+    MOD_VELOCITY,
+    __MOD_SOURCE_COUNT
+};
+
+enum ModDestination
+{
+    MOD_PITCH, // Semitones
+    MOD_CUTOFF, // Octaves
+    MOD_AMPLITUDE, // Added to a gain of 1
+    MOD_DETUNE, // Semitones on the second oscillator
+    __MOD_DESTINATION_COUNT
+};
+
+// What a route amount of 1 adds to each destination, in its units
+extern const float modDestinationRange[__MOD_DESTINATION_COUNT];
+
+// A route's amount is -1 to 1 of the destination's full range
+struct ModRoute
+{
+    uint8_t source;
+    uint8_t destination;
+    float amount;
+};
+
+// Control-rate modulation. Routes are edited in slots and compiled, on the
+// next beginBlock after a change, into flat tables of the routes that do
+// something: the ones from global sources are summed once per block, so
+// each voice only walks its own per-voice routes. Audio thread only.
+class ModMatrix
+{
+public:
+    ModMatrix();
+    ~ModMatrix();
+
+    void initialize(float sampleRate);
+
+    void setRoute(int slot, int source, int destination, float amount);
+    const ModRoute &getRoute(int slot) const { return routes_[slot]; }
+
+    // LFO rates in Hz, lfo is MOD_LFO1, MOD_LFO2 or MOD_VOICE_LFO
+    void setLfoRate(int lfo, float rate);
+    // Restarts a voice's LFO, for when it starts a new note
+    void retrigger(int voice) { voicePhase_[voice] = 0.0f; }
+
+    // Compiles the routes if they changed, advances the global LFOs past a
+    // block of size samples and sums the global routes
+    void beginBlock(size_t size);
+
+    // What the global routes add to a destination this block, all a
+    // mix-wide destination such as the global filter can follow
+    float getGlobal(int destination) const { return global_[destination]; }
+    bool isRouted(int destination) const { return (routed_ >> destination) & 1; }
+
+    // Writes a voice's destination offsets for this block, global routes
+    // included, and advances its LFO by size samples
+    void evaluate(int voice, float envelope, float velocity, size_t size, float *out);
+
+private:
+    float sampleRateRecip_;
+    ModRoute routes_[MODMATRIX_ROUTES];
+    bool dirty_;
+
+    // Compiled routes, amounts scaled to destination units
+    int numGlobal_;
+    uint8_t globalSource_[MODMATRIX_ROUTES];
+    uint8_t globalDestination_[MODMATRIX_ROUTES];
+    float globalAmount_[MODMATRIX_ROUTES];
+    int numVoice_;
+    uint8_t voiceSource_[MODMATRIX_ROUTES];
+    uint8_t voiceDestination_[MODMATRIX_ROUTES];
+    float voiceAmount_[MODMATRIX_ROUTES];
+    // Bit per destination with a route into it
+    uint32_t routed_;
+    bool voiceLfoUsed_;
+
+    float lfoPhase_[MODMATRIX_GLOBAL_LFOS];
+    float lfoInc_[MODMATRIX_GLOBAL_LFOS];
+    float voicePhase_[MODMATRIX_MAX_VOICES];
+    float voiceInc_;
+
+    float global_[__MOD_DESTINATION_COUNT];
+
+    void compile();
+};
+
+#endif // MODMATRIX_H
@@ -1,23 +1,118 @@
 #include "moogladder.h"
 #include "dsp.h"
+#include "denormal.h"
 
 using namespace daisysp;
 
-float MoogLadder::my_tanh(float x)
+static const float THERMAL = 0.000025f;
+
+#define TANH_LUT_SIZE 512
+#define TANH_LUT_RANGE 8.0f
+
+static float tanh_lut[TANH_LUT_SIZE + 1];
+static bool  tanh_lut_ready = false;
+
+namespace
+{
+struct LegacySaturator
+{
+    static inline float Sat(float x)
+    {
+        int sign = 1;
+        if(x < 0)
+        {
+            sign = -1;
+            x    = -x;
+        }
+        if(x >= 4.0)
+        {
+            return sign;
+        }
+        if(x < 0.5)
+            return x * sign;
+        return sign * tanh(x);
+    }
+};
+
+struct ExactSaturator
+{
+    static inline float Sat(float x) { return tanhf(x); }
+};
+
+// Below this tanh(x) = x - x^3 / 3 to float precision. Stage inputs are scaled
+// by THERMAL, so with signals around unity every call takes this path.
+#define SMALL_SIGNAL 0.05f
+// Below this the cubic term is under half an ulp of x, so tanh(x) rounds to
+// x. Skipping it also keeps x * x from underflowing into subnormals as a
+// tail decays.
+#define TINY_SIGNAL 2e-4f
+
+struct PadeSaturator
+{
+    static inline float Sat(float x)
+    {
+        if(x < TINY_SIGNAL && x > -TINY_SIGNAL)
+        {
+            return x;
+        }
+        float x2 = x * x;
+        if(x2 < SMALL_SIGNAL * SMALL_SIGNAL)
+        {
+            return x - x * x2 * (1.0f / 3.0f);
+        }
+        // The approximant crosses 1 just above 4.97, clamp before that
+        x  = x > 4.97f ? 4.97f : (x < -4.97f ? -4.97f : x);
+        x2 = x * x;
+        float num
+            = x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)));
+        float den
+            = 135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f));
+        return num / den;
+    }
+};
+
+struct LutSaturator
+{
+    static inline float Sat(float x)
+    {
+        // The table holds tanh(x) / x, which keeps the relative error small
+        // near zero where the ladder's 1 / THERMAL gain magnifies it
+        const float scale = TANH_LUT_SIZE / TANH_LUT_RANGE;
+        float       ax    = x < 0.0f ? -x : x;
+        if(ax < TINY_SIGNAL)
+        {
+            return x;
+        }
+        if(ax < SMALL_SIGNAL)
+        {
+            return x - x * x * x * (1.0f / 3.0f);
+        }
+        if(ax >= TANH_LUT_RANGE)
+        {
+            return x < 0.0f ? -1.0f : 1.0f;
+        }
+        float pos  = ax * scale;
+        int   i    = static_cast<int>(pos);
+        float frac = pos - i;
+        return x * (tanh_lut[i] + (tanh_lut[i + 1] - tanh_lut[i]) * frac);
+    }
+};
+} // namespace
+
+static void InitTanhLut()
 {
-    int sign = 1;
-    if(x < 0)
+    if(tanh_lut_ready)
     {
-        sign = -1;
-        x    = -x;
+        return;
     }
-    if(x >= 4.0)
+
+    tanh_lut[0] = 1.0f;
+    for(int i = 1; i <= TANH_LUT_SIZE; i++)
     {
-        return sign;
+        double x    = (TANH_LUT_RANGE * i) / TANH_LUT_SIZE;
+        tanh_lut[i] = static_cast<float>(tanh(x) / x);
     }
-    if(x < 0.5)
-        return x * sign;
-    return sign * tanh(x);
+    tanh_lut_ready = true;
 }
 
 void MoogLadder::Init(float sample_rate)
@@ -33,22 +128,54 @@ void MoogLadder::Init(float sample_rate)
         tanhstg_[i % 3] = 0.0;
     }
 
+    old_freq_  = 0.0f;
+    old_res_   = -1.0f;
+    saturator_ = SATURATOR_PADE;
+    oversampler_.initialize(1);
+
+    InitTanhLut();
+}
+
+void MoogLadder::SetOversampling(int factor)
+{
+    oversampler_.initialize(factor);
+    // The coefficients depend on the rate the ladder runs at
     old_freq_ = 0.0f;
-    old_res_  = -1.0f;
 }
 
-float MoogLadder::Process(float in)
+float MoogLadder::Saturate(Saturator saturator, float x)
 {
-    float  freq = freq_;
-    float  res  = res_;
-    float  res4;
-    float* delay   = delay_;
-    float* tanhstg = tanhstg_;
-    float  stg[4];
-    float  acr, tune;
+    switch(saturator)
+    {
+        case SATURATOR_LEGACY: return LegacySaturator::Sat(x);
+        case SATURATOR_EXACT: return ExactSaturator::Sat(x);
+        case SATURATOR_LUT: InitTanhLut(); return LutSaturator::Sat(x);
+        case SATURATOR_PADE:
+        default: return PadeSaturator::Sat(x);
+    }
+}
 
-    float THERMAL = 0.000025;
+void MoogLadder::Coefficients(float  freq,
+                              float  sample_rate,
+                              float& acr,
+                              float& tune)
+{
+    float f, fc, fc2, fc3, fcr;
+    fc  = (freq / sample_rate);
+    f   = 0.5f * fc;
+    fc2 = fc * fc;
+    fc3 = fc2 * fc2;
+
+    fcr  = 1.8730f * fc3 + 0.4955f * fc2 - 0.6490f * fc + 0.9988f;
+    acr  = -3.9364f * fc2 + 1.8409f * fc + 0.9968f;
+    tune = (1.0f - expf(-((2 * PI_F) * f * fcr))) / THERMAL;
+}
+
+void MoogLadder::UpdateCoefficients(float& res, float& acr, float& tune)
+{
+    float freq = freq_;
 
+    res = res_;
     if(res < 0)
     {
         res = 0;
@@ -56,16 +183,9 @@ float MoogLadder::Process(float in)
 
     if(old_freq_ != freq || old_res_ != res)
     {
-        float f, fc, fc2, fc3, fcr;
         old_freq_ = freq;
-        fc        = (freq / sample_rate_);
-        f         = 0.5f * fc;
-        fc2       = fc * fc;
-        fc3       = fc2 * fc2;
-
-        fcr  = 1.8730f * fc3 + 0.4955f * fc2 - 0.6490f * fc + 0.9988f;
-        acr  = -3.9364f * fc2 + 1.8409f * fc + 0.9968f;
-        tune = (1.0f - expf(-((2 * PI_F) * f * fcr))) / THERMAL;
+        Coefficients(
+            freq, sample_rate_ * oversampler_.getFactor(), acr, tune);
 
         old_res_  = res;
         old_acr_  = acr;
@@ -77,26 +197,76 @@ float MoogLadder::Process(float in)
         acr  = old_acr_;
         tune = old_tune_;
     }
+}
 
-    res4 = 4.0f * res * acr;
+float MoogLadder::Process(float in)
+{
+    ProcessBlock(&in, 1);
+    return in;
+}
+
+void MoogLadder::ProcessBlock(float* buf, size_t size)
+{
+    oversampler_.process(
+        buf, size, [this](float* b, size_t n) { ProcessRate(b, n); });
+}
+
+void MoogLadder::ProcessRate(float* buf, size_t size)
+{
+    switch(saturator_)
+    {
+        case SATURATOR_LEGACY: ProcessBlockT<LegacySaturator>(buf, size); break;
+        case SATURATOR_EXACT: ProcessBlockT<ExactSaturator>(buf, size); break;
+        case SATURATOR_LUT: ProcessBlockT<LutSaturator>(buf, size); break;
+        case SATURATOR_PADE:
+        default: ProcessBlockT<PadeSaturator>(buf, size); break;
+    }
+}
+
+template <typename Sat>
+void MoogLadder::ProcessBlockT(float* buf, size_t size)
+{
+    float res, acr, tune;
 
-    for(int j = 0; j < 2; j++)
+    UpdateCoefficients(res, acr, tune);
+
+    const float res4 = 4.0f * res * acr;
+
+    // Work on local copies of the state so it stays in registers
+    float d0 = delay_[0], d1 = delay_[1], d2 = delay_[2], d3 = delay_[3],
+          d4 = delay_[4], d5 = delay_[5];
+    float t0 = tanhstg_[0], t1 = tanhstg_[1], t2 = tanhstg_[2];
+
+    for(size_t i = 0; i < size; i++)
     {
-        in -= res4 * delay[5];
-        delay[0] = stg[0]
-            = delay[0] + tune * (my_tanh(in * THERMAL) - tanhstg[0]);
-        for(int k = 1; k < 4; k++)
+        // The DC keeps the stages from decaying into subnormals in silence
+        float in = buf[i] + SYNTH_DENORMAL_DC;
+        for(int j = 0; j < 2; j++)
         {
-            in     = stg[k - 1];
-            stg[k] = delay[k]
-                     + tune
-                           * ((tanhstg[k - 1] = my_tanh(in * THERMAL))
-                              - (k != 3 ? tanhstg[k]
-                                        : my_tanh(delay[k] * THERMAL)));
-            delay[k] = stg[k];
+            float s0, s1, s2, s3;
+            in -= res4 * d5;
+            d0 = s0 = d0 + tune * (Sat::Sat(in * THERMAL) - t0);
+            t0      = Sat::Sat(s0 * THERMAL);
+            d1 = s1 = d1 + tune * (t0 - t1);
+            t1      = Sat::Sat(s1 * THERMAL);
+            d2 = s2 = d2 + tune * (t1 - t2);
+            t2      = Sat::Sat(s2 * THERMAL);
+            d3 = s3 = d3 + tune * (t2 - Sat::Sat(d3 * THERMAL));
+            d5      = (s3 + d4) * 0.5f;
+            d4      = s3;
+            // The original stage loop leaves the third stage in `in` for the second pass
+            in = s2;
         }
-        delay[5] = (stg[3] + delay[4]) * 0.5f;
-        delay[4] = stg[3];
+        buf[i] = d5;
     }
-    return delay[5];
+
+    delay_[0]   = d0;
+    delay_[1]   = d1;
+    delay_[2]   = d2;
+    delay_[3]   = d3;
+    delay_[4]   = d4;
+    delay_[5]   = d5;
+    tanhstg_[0] = t0;
+    tanhstg_[1] = t1;
+    tanhstg_[2] = t2;
 }
@@ -11,6 +11,8 @@ https://opensource.org/license/lgpl-2-1/
 #define DSY_MOOGLADDER_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include "oversampler.h"
 #ifdef __cplusplus
 
 namespace daisysp
@@ -19,6 +21,19 @@ namespace daisysp
 class MoogLadder
 {
   public:
+    /** Nonlinearity used in the ladder stages. Max error against tanh
+        over all inputs, measured with host/bench: PADE 9.6e-5, LUT 8.5e-6.
+        Both are exact to float precision for the small stage inputs a
+        unity level signal produces.
+    */
+    enum Saturator
+    {
+        SATURATOR_LEGACY, /**< original fast tanh: linear below 0.5, libm tanh above */
+        SATURATOR_EXACT,  /**< tanhf */
+        SATURATOR_PADE,   /**< [7/6] Pade approximant, no libm */
+        SATURATOR_LUT,    /**< tanh(x) / x table with linear interpolation */
+    };
+
     MoogLadder() {}
     ~MoogLadder() {}
     /** Initializes the MoogLadder module.
@@ -31,6 +46,15 @@ class MoogLadder
     */
     float Process(float in);
 
+    /** Processes a block of samples in place. Coefficients are updated
+        once at the start of the block and the filter state is kept in
+        locals for the whole block. With oversampling the ladder runs on
+        the oversampled signal in chunks of OVERSAMPLER_CHUNK samples.
+        \param buf - samples to filter
+        \param size - number of samples in buf
+    */
+    void ProcessBlock(float* buf, size_t size);
+
     /** 
         Sets the cutoff frequency or half-way point of the filter.
         Arguments
@@ -41,11 +65,45 @@ class MoogLadder
         Sets the resonance of the filter.
     */
     inline void SetRes(float res) { res_ = res; }
+    /**
+        Selects the saturator, defaults to SATURATOR_PADE.
+    */
+    inline void SetSaturator(Saturator saturator) { saturator_ = saturator; }
+
+    /** Runs the ladder at 1x, 2x or 4x the sample rate through half-band
+        filters, on top of the two passes per sample the ladder always
+        makes. Costs roughly the factor in CPU, see host/bench oversample.
+        Resets the oversampling filters.
+    */
+    void SetOversampling(int factor);
+    inline int GetOversampling() const { return oversampler_.getFactor(); }
+
+    /** The six ladder stage states, for inspecting the filter's memory.
+    */
+    inline const float* GetState() const { return delay_; }
+
+    /** Evaluates a saturator on its own, for measuring its accuracy.
+    */
+    static float Saturate(Saturator saturator, float x);
+
+    /** Computes the stage coefficients for a cutoff, shared with
+        MoogLadderBank so both filters sound the same.
+        \param freq - cutoff in Hz
+        \param sample_rate - sample rate of the filter
+        \param acr - resonance correction, multiplies the feedback
+        \param tune - stage gain, already divided by the thermal voltage
+    */
+    static void Coefficients(float freq, float sample_rate, float& acr, float& tune);
 
   private:
     float istor_, res_, freq_, delay_[6], tanhstg_[3], old_freq_, old_res_,
         sample_rate_, old_acr_, old_tune_;
-    float my_tanh(float x);
+    Saturator   saturator_;
+    Oversampler oversampler_;
+    void        UpdateCoefficients(float& res, float& acr, float& tune);
+    void        ProcessRate(float* buf, size_t size);
+    template <typename Sat>
+    void ProcessBlockT(float* buf, size_t size);
 };
 } // namespace daisysp
 #endif
@@ -0,0 +1,163 @@
+#include "moogladderbank.h"
+#include "moogladder.h"
+#include "denormal.h"
+
+using namespace daisysp;
+
+// Must match the thermal voltage in moogladder.cpp, the tune coefficient
+// from MoogLadder::Coefficients is already divided by it
+static const float THERMAL = 0.000025f;
+
+// MoogLadder's PADE saturator
+static f32x4 saturatePade(f32x4 x)
+{
+    x = simdMin(simdMax(x, simdSet(-4.97f)), simdSet(4.97f));
+    f32x4 x2 = x * x;
+    f32x4 num = x * (simdSet(135135.0f) + x2 * (simdSet(17325.0f) + x2 * (simdSet(378.0f) + x2)));
+    f32x4 den = simdSet(135135.0f) + x2 * (simdSet(62370.0f) + x2 * (simdSet(3150.0f) + x2 * simdSet(28.0f)));
+    return simdDiv(num, den);
+}
+
+// Takes MoogLadder's small signal branch only when every lane is below the
+// threshold, which a unity level mix always is. Lanes under the tiny signal
+// threshold skip the cubic term as in MoogLadder, by zeroing it, so a
+// decaying voice's x * x * x does not underflow into subnormals. Kept small
+// so it inlines.
+static inline f32x4 saturate(f32x4 x)
+{
+    f32x4 ax = simdAbs(x);
+    if (simdAny(simdGreater(ax, simdSet(0.05f))))
+    {
+        return saturatePade(x);
+    }
+
+    f32x4 large = simdGreater(ax, simdSet(2e-4f));
+    if (!simdAny(large))
+    {
+        return x;
+    }
+
+    f32x4 c = simdSelect(large, x, simdSet(0.0f));
+    return x - c * c * c * simdSet(1.0f / 3.0f);
+}
+
+MoogLadderBank::MoogLadderBank() {}
+MoogLadderBank::~MoogLadderBank() {}
+
+void MoogLadderBank::initialize(float sampleRate)
+{
+    sampleRate_ = sampleRate;
+
+    for (int i = 0; i < MOOGLADDERBANK_MAX_VOICES; i++)
+    {
+        reset(i);
+        setVoice(i, 1000.0f, 0.4f);
+    }
+}
+
+void MoogLadderBank::reset(int voice)
+{
+    for (int s = 0; s < 6; s++)
+    {
+        delay_[s][voice] = 0.0f;
+    }
+
+    for (int s = 0; s < 3; s++)
+    {
+        tanhstg_[s][voice] = 0.0f;
+    }
+}
+
+void MoogLadderBank::setVoice(int voice, float frequency, float resonance)
+{
+    float acr, tune;
+    MoogLadder::Coefficients(frequency, sampleRate_, acr, tune);
+
+    tune_[voice] = tune;
+    res4_[voice] = 4.0f * (resonance < 0.0f ? 0.0f : resonance) * acr;
+}
+
+void MoogLadderBank::process(float *const *buffers,
+                             int numVoices,
+                             const int *activeVoices,
+                             int numActive,
+                             size_t size)
+{
+    int a = 0;
+
+    while (a < numActive)
+    {
+        int first = activeVoices[a] - activeVoices[a] % SIMD_LANES;
+        bool active[SIMD_LANES] = {false, false, false, false};
+
+        while (a < numActive && activeVoices[a] < first + SIMD_LANES && activeVoices[a] < numVoices)
+        {
+            active[activeVoices[a] - first] = true;
+            a++;
+        }
+
+        processGroup(buffers, first, active, size);
+    }
+}
+
+void MoogLadderBank::processGroup(float *const *buffers, int first, const bool *active, size_t size)
+{
+    const f32x4 thermal = simdSet(THERMAL);
+    const f32x4 half = simdSet(0.5f);
+    // Keeps the stages from decaying into subnormals in silence
+    const f32x4 dc = simdSet(SYNTH_DENORMAL_DC);
+    const f32x4 tune = simdLoad(&tune_[first]);
+    const f32x4 res4 = simdLoad(&res4_[first]);
+
+    f32x4 d0 = simdLoad(&delay_[0][first]), d1 = simdLoad(&delay_[1][first]),
+          d2 = simdLoad(&delay_[2][first]), d3 = simdLoad(&delay_[3][first]),
+          d4 = simdLoad(&delay_[4][first]), d5 = simdLoad(&delay_[5][first]);
+    f32x4 t0 = simdLoad(&tanhstg_[0][first]), t1 = simdLoad(&tanhstg_[1][first]),
+          t2 = simdLoad(&tanhstg_[2][first]);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        float sample[SIMD_LANES];
+        for (int l = 0; l < SIMD_LANES; l++)
+        {
+            sample[l] = active[l] ? buffers[first + l][i] : 0.0f;
+        }
+
+        f32x4 in = simdLoad(sample) + dc;
+        for (int j = 0; j < 2; j++)
+        {
+            f32x4 s0, s1, s2, s3;
+            in = in - res4 * d5;
+            d0 = s0 = d0 + tune * (saturate(in * thermal) - t0);
+            t0 = saturate(s0 * thermal);
+            d1 = s1 = d1 + tune * (t0 - t1);
+            t1 = saturate(s1 * thermal);
+            d2 = s2 = d2 + tune * (t1 - t2);
+            t2 = saturate(s2 * thermal);
+            d3 = s3 = d3 + tune * (t2 - saturate(d3 * thermal));
+            d5 = (s3 + d4) * half;
+            d4 = s3;
+            // Same quirk as MoogLadder, the second pass starts from the third stage
+            in = s2;
+        }
+
+        simdStore(sample, d5);
+        for (int l = 0; l < SIMD_LANES; l++)
+        {
+            if (active[l])
+            {
+                buffers[first + l][i] = sample[l];
+            }
+        }
+    }
+
+    simdStore(&delay_[0][first], d0);
+    simdStore(&delay_[1][first], d1);
+    simdStore(&delay_[2][first], d2);
+    simdStore(&delay_[3][first], d3);
+    simdStore(&delay_[4][first], d4);
+    simdStore(&delay_[5][first], d5);
+    simdStore(&tanhstg_[0][first], t0);
+    simdStore(&tanhstg_[1][first], t1);
+    simdStore(&tanhstg_[2][first], t2);
+}
@@ -0,0 +1,47 @@
+#ifndef MOOGLADDERBANK_H
+#define MOOGLADDERBANK_H
+#include <stddef.h>
+#include "simd.h"
+
+#define MOOGLADDERBANK_MAX_VOICES 64
+
+// One MoogLadder per voice, SIMD_LANES voices' ladder stages per
+// instruction. Same algorithm as MoogLadder with the PADE saturator.
+// Coefficients are set per voice, normally once per block.
+class MoogLadderBank
+{
+public:
+    MoogLadderBank();
+    ~MoogLadderBank();
+
+    void initialize(float sampleRate);
+    void setVoice(int voice, float frequency, float resonance);
+
+    // Clears a voice's filter state, for when it starts a new note
+    void reset(int voice);
+
+    // One of the six ladder stage states of every voice, for inspecting
+    // the filters' memory
+    const float *getState(int stage) const { return delay_[stage]; }
+
+    // Filters buffers in place. Only the lane groups holding one of the
+    // ascending activeVoices are processed, idle lanes read silence and
+    // their buffers are left alone.
+    void process(float *const *buffers,
+                 int numVoices,
+                 const int *activeVoices,
+                 int numActive,
+                 size_t size);
+
+private:
+    float sampleRate_;
+
+    float delay_[6][MOOGLADDERBANK_MAX_VOICES];
+    float tanhstg_[3][MOOGLADDERBANK_MAX_VOICES];
+    float tune_[MOOGLADDERBANK_MAX_VOICES];
+    float res4_[MOOGLADDERBANK_MAX_VOICES];
+
+    void processGroup(float *const *buffers, int first, const bool *active, size_t size);
+};
+
+#endif // MOOGLADDERBANK_H
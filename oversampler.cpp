@@ -0,0 +1,188 @@
+#include "oversampler.h"
+#include <math.h>
+
+// Kaiser window shape, trades transition width for stopband rejection
+#define HALFBAND_KAISER_BETA 6.0
+
+// Modified Bessel function of the first kind, order 0
+static double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+
+    return sum;
+}
+
+HalfBand::HalfBand() {}
+HalfBand::~HalfBand() {}
+
+void HalfBand::initialize(int pairs)
+{
+    pairs_ = pairs < 1 ? 1 : (pairs > HALFBAND_MAX_PAIRS ? HALFBAND_MAX_PAIRS : pairs);
+
+    // Tap 2j + 1 either side of the middle, the even ones are zero
+    double sum = 0.0;
+    double coeff[HALFBAND_MAX_PAIRS];
+    for (int j = 0; j < pairs_; j++)
+    {
+        double d = 2 * j + 1;
+        double r = d / (2.0 * pairs_);
+        double window = besselI0(HALFBAND_KAISER_BETA * sqrt(1.0 - r * r)) / besselI0(HALFBAND_KAISER_BETA);
+        coeff[j] = (j % 2 == 0 ? 1.0 : -1.0) / (M_PI * d) * window;
+        sum += coeff[j];
+    }
+
+    // Unity DC gain: the middle tap's 0.5 plus both sides of the pairs
+    for (int j = 0; j < pairs_; j++)
+    {
+        coeff_[j] = (float)(coeff[j] * 0.25 / sum);
+    }
+
+    reset();
+}
+
+void HalfBand::reset()
+{
+    for (int i = 0; i < 4 * HALFBAND_MAX_PAIRS; i++)
+    {
+        history_[i] = middle_[i] = 0.0f;
+    }
+    pos_ = 0;
+}
+
+void HalfBand::push(float *buffer, float x)
+{
+    buffer[pos_] = buffer[pos_ + 2 * pairs_] = x;
+}
+
+void HalfBand::interpolate(float in, float &out0, float &out1)
+{
+    const int pairs = pairs_;
+
+    if (++pos_ >= 2 * pairs)
+    {
+        pos_ = 0;
+    }
+    push(history_, in);
+
+    // x[n - m] is h[2 * pairs - m]
+    const float *h = &history_[pos_];
+    float sum = 0.0f;
+    for (int j = 0; j < pairs; j++)
+    {
+        sum += coeff_[j] * (h[pairs + 1 + j] + h[pairs - j]);
+    }
+
+    // Zero stuffing halves the level, the filter makes it up
+    out0 = 2.0f * sum;
+    out1 = h[pairs + 1];
+}
+
+float HalfBand::decimate(float in0, float in1)
+{
+    const int pairs = pairs_;
+
+    if (++pos_ >= 2 * pairs)
+    {
+        pos_ = 0;
+    }
+    push(history_, in0);
+    push(middle_, in1);
+
+    // The middle tap lands on the odd samples and the pairs on the even
+    // ones, which with interpolate() makes a round trip a whole number of
+    // samples long
+    const float *h = &history_[pos_];
+    float sum = 0.5f * middle_[pos_ + pairs];
+    for (int j = 0; j < pairs; j++)
+    {
+        sum += coeff_[j] * (h[pairs + 1 + j] + h[pairs - j]);
+    }
+
+    return sum;
+}
+
+Oversampler::Oversampler() {}
+Oversampler::~Oversampler() {}
+
+void Oversampler::initialize(int factor)
+{
+    factor_ = factor >= 4 ? 4 : (factor >= 2 ? 2 : 1);
+
+    up_[0].initialize(HALFBAND_PAIRS_FIRST);
+    down_[0].initialize(HALFBAND_PAIRS_FIRST);
+    up_[1].initialize(HALFBAND_PAIRS_SECOND);
+    down_[1].initialize(HALFBAND_PAIRS_SECOND);
+    delayed_ = 0.0f;
+}
+
+void Oversampler::reset()
+{
+    for (int s = 0; s < 2; s++)
+    {
+        up_[s].reset();
+        down_[s].reset();
+    }
+    delayed_ = 0.0f;
+}
+
+void Oversampler::up(const float *in, float *out, size_t size)
+{
+    if (factor_ == 1)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            out[i] = in[i];
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        float a, b;
+        up_[0].interpolate(in[i], a, b);
+
+        if (factor_ == 2)
+        {
+            out[2 * i] = a;
+            out[2 * i + 1] = b;
+            continue;
+        }
+
+        up_[1].interpolate(a, out[4 * i], out[4 * i + 1]);
+        up_[1].interpolate(b, out[4 * i + 2], out[4 * i + 3]);
+    }
+}
+
+void Oversampler::down(const float *in, float *out, size_t size)
+{
+    if (factor_ == 1)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            out[i] = in[i];
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        if (factor_ == 2)
+        {
+            out[i] = down_[0].decimate(in[2 * i], in[2 * i + 1]);
+            continue;
+        }
+
+        // The second stage's round trip is an odd number of samples at 2x,
+        // one more sample of delay makes the 4x latency whole
+        float a = down_[1].decimate(in[4 * i], in[4 * i + 1]);
+        float b = down_[1].decimate(in[4 * i + 2], in[4 * i + 3]);
+        out[i] = down_[0].decimate(delayed_, a);
+        delayed_ = b;
+    }
+}
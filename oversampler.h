@@ -0,0 +1,108 @@
+#ifndef OVERSAMPLER_H
+#define OVERSAMPLER_H
+#include <stddef.h>
+
+// Coefficient pairs of the first and second half-band stages. Both give
+// about 65 dB of stopband rejection, the second stage runs at twice the rate
+// so it has a wider transition band and needs fewer taps.
+#define HALFBAND_PAIRS_FIRST 12
+#define HALFBAND_PAIRS_SECOND 4
+#define HALFBAND_MAX_PAIRS HALFBAND_PAIRS_FIRST
+
+#define OVERSAMPLER_MAX_FACTOR 4
+// Input samples process() handles per pass, bounds the buffer on the stack
+#define OVERSAMPLER_CHUNK 32
+
+// Polyphase half-band FIR for changing the rate by 2. Every other tap of a
+// half-band filter is zero and the middle one is 0.5, so interpolating
+// computes one output with pairs multiplies and copies the other, and
+// decimating runs the taps over only one of each two inputs. One instance either
+// interpolates or decimates, the history is not shared.
+class HalfBand
+{
+public:
+    HalfBand();
+    ~HalfBand();
+
+    // Kaiser windowed sinc with pairs coefficient pairs, up to HALFBAND_MAX_PAIRS
+    void initialize(int pairs);
+    void reset();
+
+    // Two output samples, at twice the rate, for one input
+    void interpolate(float in, float &out0, float &out1);
+    // One output sample for two inputs, at half the rate
+    float decimate(float in0, float in1);
+
+private:
+    int pairs_;
+    float coeff_[HALFBAND_MAX_PAIRS];
+
+    // Last 2 * pairs_ samples, written twice so they can be read without
+    // wrapping: sample n - m is at history_[pos_ + 2 * pairs_ - m]
+    float history_[4 * HALFBAND_MAX_PAIRS];
+    // Decimating only, the samples that meet the middle tap
+    float middle_[4 * HALFBAND_MAX_PAIRS];
+    int pos_;
+
+    void push(float *buffer, float x);
+};
+
+// Runs a processor at 1x, 2x or 4x the sample rate: upsamples a block with
+// cascaded half-band stages, lets the processor work on the oversampled
+// block and filters it back down. Anything nonlinear can sit in the middle.
+class Oversampler
+{
+public:
+    Oversampler();
+    ~Oversampler();
+
+    // factor is 1, 2 or 4, anything else is rounded down to one of them
+    void initialize(int factor);
+    void reset();
+
+    int getFactor() const { return factor_; }
+    // Samples a round trip through up() and down() delays by
+    int getLatency() const
+    {
+        return factor_ == 1 ? 0 : (2 * HALFBAND_PAIRS_FIRST - 1) + (factor_ == 4 ? HALFBAND_PAIRS_SECOND : 0);
+    }
+
+    // out gets size * getFactor() samples
+    void up(const float *in, float *out, size_t size);
+    // in holds size * getFactor() samples
+    void down(const float *in, float *out, size_t size);
+
+    // Filters buf in place, calling process(float *buffer, size_t size) on
+    // oversampled chunks. At 1x process runs on buf directly.
+    template <typename Process>
+    void process(float *buf, size_t size, Process process)
+    {
+        if (factor_ == 1)
+        {
+            process(buf, size);
+            return;
+        }
+
+        float oversampled[OVERSAMPLER_MAX_FACTOR * OVERSAMPLER_CHUNK];
+
+        while (size > 0)
+        {
+            size_t n = size < OVERSAMPLER_CHUNK ? size : OVERSAMPLER_CHUNK;
+
+            up(buf, oversampled, n);
+            process(oversampled, n * factor_);
+            down(oversampled, buf, n);
+
+            buf += n;
+            size -= n;
+        }
+    }
+
+private:
+    int factor_;
+    HalfBand up_[2];
+    HalfBand down_[2];
+    float delayed_;
+};
+
+#endif // OVERSAMPLER_H
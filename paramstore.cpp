@@ -0,0 +1,87 @@
+#include "paramstore.h"
+#include <math.h>
+
+// Relative distance at which a glide snaps to its target and stops
+#define PARAMSTORE_SNAP 0.0001f
+
+ParamStore::ParamStore() {}
+ParamStore::~ParamStore() {}
+
+void ParamStore::initialize(float sampleRate)
+{
+    sampleRate_ = sampleRate;
+    moving_ = 0;
+    dirty_ = 0;
+
+    for (int i = 0; i < PARAMSTORE_MAX_PARAMS; i++)
+    {
+        define(i, 0.0f, 0.0f);
+    }
+}
+
+void ParamStore::define(int param, float value, float smoothingSeconds)
+{
+    Param &p = params_[param];
+
+    p.value = p.target = value;
+    p.rate = smoothingSeconds > 0.0f ? 1.0f / (smoothingSeconds * sampleRate_) : 0.0f;
+    moving_ &= ~(1u << param);
+}
+
+void ParamStore::set(int param, float target)
+{
+    Param &p = params_[param];
+
+    if (p.rate == 0.0f)
+    {
+        jump(param, target);
+        return;
+    }
+
+    p.target = target;
+    moving_ |= 1u << param;
+}
+
+void ParamStore::jump(int param, float value)
+{
+    Param &p = params_[param];
+
+    p.value = p.target = value;
+    moving_ &= ~(1u << param);
+    dirty_ |= 1u << param;
+}
+
+void ParamStore::update(size_t size)
+{
+    uint32_t moving = moving_;
+
+    while (moving)
+    {
+        int i = __builtin_ctz(moving);
+        moving &= moving - 1;
+
+        Param &p = params_[i];
+        float distance = p.target - p.value;
+        float snap = PARAMSTORE_SNAP * (fabsf(p.target) > 1.0f ? fabsf(p.target) : 1.0f);
+
+        if (fabsf(distance) <= snap)
+        {
+            p.value = p.target;
+            moving_ &= ~(1u << i);
+        }
+        else
+        {
+            // Same as size steps of a per-sample one-pole
+            p.value += distance * (1.0f - expf(-p.rate * size));
+        }
+
+        dirty_ |= 1u << i;
+    }
+}
+
+uint32_t ParamStore::takeDirty()
+{
+    uint32_t dirty = dirty_;
+    dirty_ = 0;
+    return dirty;
+}
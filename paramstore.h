@@ -0,0 +1,50 @@
+#ifndef PARAMSTORE_H
+#define PARAMSTORE_H
+#include <stddef.h>
+#include <stdint.h>
+
+#define PARAMSTORE_MAX_PARAMS 32
+
+// Control-rate parameters. Each has a value, a target it glides to and a
+// smoothing time; update() moves them once per block and marks the ones that
+// changed dirty, so coefficients are only recomputed when a value moved.
+class ParamStore
+{
+public:
+    ParamStore();
+    ~ParamStore();
+
+    void initialize(float sampleRate);
+
+    // Sets a parameter's starting value and smoothing time, without marking it dirty
+    void define(int param, float value, float smoothingSeconds);
+
+    // Glides towards target, or jumps there if the smoothing time is 0
+    void set(int param, float target);
+    // Jumps to value
+    void jump(int param, float value);
+
+    float get(int param) const { return params_[param].value; }
+
+    // Advances the gliding parameters by size samples
+    void update(size_t size);
+
+    // Bit mask of the parameters that changed since the last call
+    uint32_t takeDirty();
+
+private:
+    struct Param
+    {
+        float value;
+        float target;
+        // Fraction of the distance to target covered per sample, 0 to jump
+        float rate;
+    };
+
+    float sampleRate_;
+    Param params_[PARAMSTORE_MAX_PARAMS];
+    uint32_t moving_;
+    uint32_t dirty_;
+};
+
+#endif // PARAMSTORE_H
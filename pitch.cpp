@@ -0,0 +1,20 @@
+#include "pitch.h"
+
+const float pitchExp2Table[PITCH_TABLE_SIZE] = {
+    1.000000000f, 1.010889286f, 1.021897149f, 1.033024879f,
+    1.044273782f, 1.055645178f, 1.067140401f, 1.078760798f,
+    1.090507733f, 1.102382583f, 1.114386743f, 1.126521619f,
+    1.138788635f, 1.151189230f, 1.163724859f, 1.176396992f,
+    1.189207115f, 1.202156731f, 1.215247360f, 1.228480536f,
+    1.241857812f, 1.255380757f, 1.269050957f, 1.282870016f,
+    1.296839555f, 1.310961212f, 1.325236643f, 1.339667524f,
+    1.354255547f, 1.369002423f, 1.383909882f, 1.398979673f,
+    1.414213562f, 1.429613338f, 1.445180807f, 1.460917794f,
+    1.476826146f, 1.492907728f, 1.509164428f, 1.525598151f,
+    1.542210825f, 1.559004400f, 1.575980845f, 1.593142151f,
+    1.610490332f, 1.628027422f, 1.645755478f, 1.663676580f,
+    1.681792831f, 1.700106354f, 1.718619298f, 1.737333835f,
+    1.756252160f, 1.775376493f, 1.794709075f, 1.814252176f,
+    1.834008086f, 1.853979125f, 1.874167634f, 1.894575982f,
+    1.915206561f, 1.936061793f, 1.957144124f, 1.978456026f,
+};
@@ -0,0 +1,52 @@
+#ifndef PITCH_H
+#define PITCH_H
+#include <stdint.h>
+#include <string.h>
+
+#define PITCH_TABLE_SIZE 64
+
+// 2^(i / PITCH_TABLE_SIZE) for i in [0, PITCH_TABLE_SIZE)
+extern const float pitchExp2Table[PITCH_TABLE_SIZE];
+
+// 2^x without powf: the integer part goes straight into the exponent, the
+// fraction is a table step times a second order correction for the rest.
+// Relative error is below 4e-7, under a thousandth of a cent. x is clamped
+// to the normal float range.
+inline float fastExp2(float x)
+{
+    x = x < -126.0f ? -126.0f : (x > 127.0f ? 127.0f : x);
+
+    int whole = (int)x;
+    whole -= x < whole ? 1 : 0;
+
+    float steps = (x - whole) * PITCH_TABLE_SIZE;
+    int step = (int)steps;
+    // x - whole rounds up to 1 for x just below 0, which is 2^(whole + 1)
+    if (step >= PITCH_TABLE_SIZE)
+    {
+        step = 0;
+        whole++;
+        steps = 0.0f;
+    }
+    float rest = (steps - step) * (0.693147181f / PITCH_TABLE_SIZE);
+    float fraction = pitchExp2Table[step] * (1.0f + rest * (1.0f + 0.5f * rest));
+
+    uint32_t bits = (uint32_t)(whole + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return fraction * scale;
+}
+
+// Frequency ratio of an interval
+inline float semitonesToRatio(float semitones)
+{
+    return fastExp2(semitones * (1.0f / 12.0f));
+}
+
+// MIDI note to Hz, A4 = 69 = 440 Hz, fractional notes allowed
+inline float fastMtof(float note)
+{
+    return 440.0f * fastExp2((note - 69.0f) * (1.0f / 12.0f));
+}
+
+#endif // PITCH_H
@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <string.h>
 #include "reverbsc.h"
+#include "denormal.h"
+#include "simd.h"
 
 #define REVSC_OK 0
 #define REVSC_NOT_OK 1
@@ -38,11 +40,11 @@ static const float kReverbParams[8][4]
 
 static int DelayLineMaxSamples(float sr, float i_pitch_mod, int n);
 //static int InitDelayLine(dsy_reverbsc_dl *lp, int n);
-static int         DelayLineBytesAlloc(float sr, float i_pitch_mod, int n);
 static const float kOutputGain = 0.35;
 static const float kJpScale    = 0.25;
 
-int ReverbSc::Init(float sr)
+template <typename Storage>
+int ReverbScT<Storage>::Init(float sr)
 {
     i_sample_rate_ = sr;
     sample_rate_   = sr;
@@ -52,17 +54,18 @@ int ReverbSc::Init(float sr)
     i_skip_init_   = 0;
     damp_fact_     = 1.0;
     prv_lpfreq_    = 0.0;
-    init_done_     = 1;
-    int i, n_bytes = 0;
-    n_bytes = 0;
+    init_done_     = 0;
+    int i, n_samples = 0;
     for(i = 0; i < 8; i++)
     {
-        if(n_bytes > DSY_REVERBSC_MAX_SIZE)
+        /* offsets are in samples of aux_, not bytes */
+        if(n_samples + DelayLineMaxSamples(sr, 1, i) > DSY_REVERBSC_MAX_SIZE)
             return 1;
-        delay_lines_[i].buf = (aux_) + n_bytes;
+        delay_lines_[i].buf = (aux_) + n_samples;
         InitDelayLine(&delay_lines_[i], i);
-        n_bytes += DelayLineBytesAlloc(sr, 1, i);
+        n_samples += DelayLineMaxSamples(sr, 1, i);
     }
+    init_done_ = 1;
     return 0;
 }
 
@@ -75,15 +78,8 @@ static int DelayLineMaxSamples(float sr, float i_pitch_mod, int n)
     return (int)(max_del * sr + 16.5);
 }
 
-static int DelayLineBytesAlloc(float sr, float i_pitch_mod, int n)
-{
-    int n_bytes = 0;
-
-    n_bytes += (DelayLineMaxSamples(sr, i_pitch_mod, n) * (int)sizeof(float));
-    return n_bytes;
-}
-
-void ReverbSc::NextRandomLineseg(ReverbScDl *lp, int n)
+template <typename Storage>
+void ReverbScT<Storage>::NextRandomLineseg(DelayLine *lp, int n)
 {
     float prv_del, nxt_del, phs_inc_val;
 
@@ -110,7 +106,8 @@ void ReverbSc::NextRandomLineseg(ReverbScDl *lp, int n)
     lp->read_pos_frac_inc = (int)(phs_inc_val * DELAYPOS_SCALE + 0.5);
 }
 
-int ReverbSc::InitDelayLine(ReverbScDl *lp, int n)
+template <typename Storage>
+int ReverbScT<Storage>::InitDelayLine(DelayLine *lp, int n)
 {
     float read_pos;
     /* int     i; */
@@ -134,38 +131,112 @@ int ReverbSc::InitDelayLine(ReverbScDl *lp, int n)
     lp->filter_state = 0.0;
     for(int i = 0; i < lp->buffer_size; i++)
     {
-        lp->buf[i] = 0;
+        lp->buf[i] = Storage::store(0.0f);
     }
     return REVSC_OK;
 }
 
-int ReverbSc::Process(const float &in1,
-                      const float &in2,
-                      float *      out1,
-                      float *      out2)
+template <typename Storage>
+void ReverbScT<Storage>::UpdateDampFact()
 {
-    float       a_in_l, a_in_r, a_out_l, a_out_r;
-    float       vm1, v0, v1, v2, am1, a0, a1, a2, frac;
-    ReverbScDl *lp;
-    int         read_pos;
-    uint32_t    n;
-    int         buffer_size; /* Local copy */
-    float       damp_fact = damp_fact_;
-
-    //if (init_done_ <= 0) return REVSC_NOT_OK;
-    if(init_done_ <= 0)
-        return REVSC_NOT_OK;
-
     /* calculate tone filter coefficient if frequency changed */
     if(lpfreq_ != prv_lpfreq_)
     {
+        float damp_fact;
         prv_lpfreq_ = lpfreq_;
         damp_fact
             = 2.0f - cosf(prv_lpfreq_ * (2.0f * (float)M_PI) / sample_rate_);
-        damp_fact = damp_fact_
-            = damp_fact - sqrtf(damp_fact * damp_fact - 1.0f);
+        damp_fact_ = damp_fact - sqrtf(damp_fact * damp_fact - 1.0f);
+    }
+}
+
+/* at buffer wrap-around, need to check index. Kept out of ReadTaps so that
+   stays small enough to inline. */
+template <typename Storage>
+void ReverbScT<Storage>::ReadTapsWrapped(DelayLine *lp,
+                                         int        read_pos,
+                                         float *    vm1,
+                                         float *    v0,
+                                         float *    v1,
+                                         float *    v2)
+{
+    int buffer_size = lp->buffer_size;
+
+    if(--read_pos < 0)
+        read_pos += buffer_size;
+    *vm1 = Storage::load(lp->buf[read_pos]);
+    if(++read_pos >= buffer_size)
+        read_pos -= buffer_size;
+    *v0 = Storage::load(lp->buf[read_pos]);
+    if(++read_pos >= buffer_size)
+        read_pos -= buffer_size;
+    *v1 = Storage::load(lp->buf[read_pos]);
+    if(++read_pos >= buffer_size)
+        read_pos -= buffer_size;
+    *v2 = Storage::load(lp->buf[read_pos]);
+}
+
+/* Advances delay line n's read position and fetches the four samples around
+   it, returning the fractional part of the position. */
+template <typename Storage>
+inline float ReverbScT<Storage>::ReadTaps(DelayLine *lp,
+                                int         n,
+                                float *     vm1,
+                                float *     v0,
+                                float *     v1,
+                                float *     v2)
+{
+    int   read_pos;
+    int   buffer_size = lp->buffer_size;
+    float frac;
+
+    if(lp->read_pos_frac >= DELAYPOS_SCALE)
+    {
+        lp->read_pos += (lp->read_pos_frac >> DELAYPOS_SHIFT);
+        lp->read_pos_frac &= DELAYPOS_MASK;
+    }
+    if(lp->read_pos >= buffer_size)
+        lp->read_pos -= buffer_size;
+    read_pos = lp->read_pos;
+    frac     = (float)lp->read_pos_frac * (1.0 / (float)DELAYPOS_SCALE);
+
+    /* read four samples for interpolation */
+
+    if(read_pos > 0 && read_pos < (buffer_size - 2))
+    {
+        *vm1 = Storage::load(lp->buf[read_pos - 1]);
+        *v0  = Storage::load(lp->buf[read_pos]);
+        *v1  = Storage::load(lp->buf[read_pos + 1]);
+        *v2  = Storage::load(lp->buf[read_pos + 2]);
+    }
+    else
+    {
+        ReadTapsWrapped(lp, read_pos, vm1, v0, v1, v2);
     }
 
+    /* update buffer read position */
+
+    lp->read_pos_frac += lp->read_pos_frac_inc;
+
+    /* start next random line segment if current one has reached endpoint */
+
+    if(--(lp->rand_line_cnt) <= 0)
+    {
+        NextRandomLineseg(lp, n);
+    }
+
+    return frac;
+}
+
+template <typename Storage>
+inline void ReverbScT<Storage>::ProcessFrame(float in1, float in2, float *out1, float *out2)
+{
+    float       a_in_l, a_in_r, a_out_l, a_out_r;
+    float       vm1, v0, v1, v2, am1, a0, a1, a2, frac;
+    DelayLine * lp;
+    uint32_t    n;
+    float       damp_fact = damp_fact_;
+
     /* calculate "resultant junction pressure" and mix to input signals */
 
     a_in_l = a_out_l = a_out_r = 0.0;
@@ -181,29 +252,20 @@ int ReverbSc::Process(const float &in1,
 
     for(n = 0; n < 8; n++)
     {
-        lp          = &delay_lines_[n];
-        buffer_size = lp->buffer_size;
+        lp = &delay_lines_[n];
 
         /* send input signal and feedback to delay line */
 
         lp->buf[lp->write_pos]
-            = (float)((n & 1 ? a_in_r : a_in_l) - lp->filter_state);
-        if(++lp->write_pos >= buffer_size)
+            = Storage::store((n & 1 ? a_in_r : a_in_l) - lp->filter_state);
+        if(++lp->write_pos >= lp->buffer_size)
         {
-            lp->write_pos -= buffer_size;
+            lp->write_pos -= lp->buffer_size;
         }
 
         /* read from delay line with cubic interpolation */
 
-        if(lp->read_pos_frac >= DELAYPOS_SCALE)
-        {
-            lp->read_pos += (lp->read_pos_frac >> DELAYPOS_SHIFT);
-            lp->read_pos_frac &= DELAYPOS_MASK;
-        }
-        if(lp->read_pos >= buffer_size)
-            lp->read_pos -= buffer_size;
-        read_pos = lp->read_pos;
-        frac     = (float)lp->read_pos_frac * (1.0 / (float)DELAYPOS_SCALE);
+        frac = ReadTaps(lp, n, &vm1, &v0, &v1, &v2);
 
         /* calculate interpolation coefficients */
 
@@ -219,42 +281,13 @@ int ReverbSc::Process(const float &in1,
         am1 -= a2;
         a0 -= frac;
 
-        /* read four samples for interpolation */
-
-        if(read_pos > 0 && read_pos < (buffer_size - 2))
-        {
-            vm1 = (float)(lp->buf[read_pos - 1]);
-            v0  = (float)(lp->buf[read_pos]);
-            v1  = (float)(lp->buf[read_pos + 1]);
-            v2  = (float)(lp->buf[read_pos + 2]);
-        }
-        else
-        {
-            /* at buffer wrap-around, need to check index */
-
-            if(--read_pos < 0)
-                read_pos += buffer_size;
-            vm1 = (float)lp->buf[read_pos];
-            if(++read_pos >= buffer_size)
-                read_pos -= buffer_size;
-            v0 = (float)lp->buf[read_pos];
-            if(++read_pos >= buffer_size)
-                read_pos -= buffer_size;
-            v1 = (float)lp->buf[read_pos];
-            if(++read_pos >= buffer_size)
-                read_pos -= buffer_size;
-            v2 = (float)lp->buf[read_pos];
-        }
         v0 = (am1 * vm1 + a0 * v0 + a1 * v1 + a2 * v2) * frac + v0;
 
-        /* update buffer read position */
-
-        lp->read_pos_frac += lp->read_pos_frac_inc;
-
-        /* apply feedback gain and lowpass filter */
+        /* apply feedback gain and lowpass filter, the DC keeps the state
+           from decaying into subnormals in silence */
 
         v0 *= (float)feedback_;
-        v0               = (lp->filter_state - v0) * damp_fact + v0;
+        v0 = (lp->filter_state - v0) * damp_fact + v0 + SYNTH_DENORMAL_DC;
         lp->filter_state = v0;
 
         /* mix to output */
@@ -267,17 +300,131 @@ int ReverbSc::Process(const float &in1,
         {
             a_out_l += v0;
         }
+    }
+    /* someday, use a_out_r for multimono out */
+
+    *out1 = a_out_l * kOutputGain;
+    *out2 = a_out_r * kOutputGain;
+}
+
+template <typename Storage>
+int ReverbScT<Storage>::Process(const float &in1,
+                      const float &in2,
+                      float *      out1,
+                      float *      out2)
+{
+    if(init_done_ <= 0)
+        return REVSC_NOT_OK;
 
-        /* start next random line segment if current one has reached endpoint */
+    UpdateDampFact();
+    ProcessFrame(in1, in2, out1, out2);
+    return REVSC_OK;
+}
 
-        if(--(lp->rand_line_cnt) <= 0)
+template <typename Storage>
+int ReverbScT<Storage>::ProcessBlock(const float *in1,
+                           const float *in2,
+                           float *      out1,
+                           float *      out2,
+                           size_t       size)
+{
+    if(init_done_ <= 0)
+        return REVSC_NOT_OK;
+
+    UpdateDampFact();
+
+    /* Same as ProcessFrame with the eight delay lines in two vectors of
+       four. Positions and buffer reads stay scalar, the interpolation,
+       feedback and damping run in the lanes. */
+
+    const f32x4 damp_fact = simdSet(damp_fact_);
+    const f32x4 feedback  = simdSet(feedback_);
+    const f32x4 one       = simdSet(1.0f);
+    const f32x4 half      = simdSet(0.5f);
+    const f32x4 sixth     = simdSet(1.0f / 6.0f);
+    const f32x4 three     = simdSet(3.0f);
+    /* keeps the lowpass states from decaying into subnormals in silence */
+    const f32x4 denormal_dc = simdSet(SYNTH_DENORMAL_DC);
+
+    float state[8], a_in[8], frac[8], vm1[8], v0[8], v1[8], v2[8], sum[4];
+    int   n;
+
+    for(n = 0; n < 8; n++)
+    {
+        state[n] = delay_lines_[n].filter_state;
+    }
+
+    for(size_t i = 0; i < size; i++)
+    {
+        /* calculate "resultant junction pressure" and mix to input signals */
+
+        float jp = 0.0f;
+        for(n = 0; n < 8; n++)
+        {
+            jp += state[n];
+        }
+        jp *= kJpScale;
+        for(n = 0; n < 8; n += 2)
         {
-            NextRandomLineseg(lp, n);
+            a_in[n]     = jp + in1[i];
+            a_in[n + 1] = jp + in2[i];
         }
+
+        for(n = 0; n < 8; n++)
+        {
+            DelayLine *lp = &delay_lines_[n];
+
+            lp->buf[lp->write_pos] = Storage::store(a_in[n] - state[n]);
+            if(++lp->write_pos >= lp->buffer_size)
+            {
+                lp->write_pos -= lp->buffer_size;
+            }
+
+            frac[n] = ReadTaps(lp, n, &vm1[n], &v0[n], &v1[n], &v2[n]);
+        }
+
+        f32x4 out = simdSet(0.0f);
+        for(n = 0; n < 8; n += SIMD_LANES)
+        {
+            f32x4 f  = simdLoad(&frac[n]);
+            f32x4 a2 = (f * f - one) * sixth;
+            f32x4 a1 = (f + one) * half;
+            f32x4 am1, a0;
+            am1 = a1 - one;
+            a0  = three * a2;
+            a1  = a1 - a0;
+            am1 = am1 - a2;
+            a0  = a0 - f;
+
+            f32x4 x0 = simdLoad(&v0[n]);
+            f32x4 v  = (am1 * simdLoad(&vm1[n]) + a0 * x0 + a1 * simdLoad(&v1[n])
+                       + a2 * simdLoad(&v2[n]))
+                          * f
+                      + x0;
+
+            /* apply feedback gain and lowpass filter */
+
+            v *= feedback;
+            v = (simdLoad(&state[n]) - v) * damp_fact + v + denormal_dc;
+            simdStore(&state[n], v);
+            out += v;
+        }
+
+        /* even lines go left, odd lines right */
+
+        simdStore(sum, out);
+        out1[i] = (sum[0] + sum[2]) * kOutputGain;
+        out2[i] = (sum[1] + sum[3]) * kOutputGain;
+    }
+
+    for(n = 0; n < 8; n++)
+    {
+        delay_lines_[n].filter_state = state[n];
     }
-    /* someday, use a_out_r for multimono out */
 
-    *out1 = a_out_l * kOutputGain;
-    *out2 = a_out_r * kOutputGain;
     return REVSC_OK;
 }
+
+template class daisysp::ReverbScT<StorageFloat>;
+template class daisysp::ReverbScT<StorageInt16>;
+template class daisysp::ReverbScT<StorageBf16>;
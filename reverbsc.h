@@ -10,32 +10,44 @@ https://opensource.org/license/lgpl-2-1/
 #ifndef DSYSP_REVERBSC_H
 #define DSYSP_REVERBSC_H
 
-#define DSY_REVERBSC_MAX_SIZE 98936
+#include <stddef.h>
+#include "samplestorage.h"
+
+/** Delay memory in samples, enough for sample rates up to 48kHz */
+#define DSY_REVERBSC_MAX_SIZE 24736
 
 namespace daisysp
 {
 /**Delay line for internal reverb use
 */
-typedef struct
+template <typename T>
+struct ReverbScDlT
 {
-    int    write_pos;         /**< write position */
-    int    buffer_size;       /**< buffer size */
-    int    read_pos;          /**< read position */
-    int    read_pos_frac;     /**< fractional component of read pos */
-    int    read_pos_frac_inc; /**< increment for fractional */
-    int    dummy;             /**<  dummy var */
-    int    seed_val;          /**< randseed */
-    int    rand_line_cnt;     /**< number of random lines */
-    float  filter_state;      /**< state of filter */
-    float *buf;               /**< buffer ptr */
-} ReverbScDl;
-
-/** Stereo Reverb */
-class ReverbSc
+    int write_pos;         /**< write position */
+    int buffer_size;       /**< buffer size */
+    int read_pos;          /**< read position */
+    int read_pos_frac;     /**< fractional component of read pos */
+    int read_pos_frac_inc; /**< increment for fractional */
+    int dummy;             /**<  dummy var */
+    int seed_val;          /**< randseed */
+    int rand_line_cnt;     /**< number of random lines */
+    float filter_state;    /**< state of filter */
+    T *   buf;             /**< buffer ptr */
+};
+
+typedef ReverbScDlT<float> ReverbScDl;
+
+/** Stereo Reverb
+    \tparam Storage - delay memory format from samplestorage.h
+*/
+template <typename Storage>
+class ReverbScT
 {
   public:
-    ReverbSc() {}
-    ~ReverbSc() {}
+    typedef typename Storage::Sample Sample;
+
+    ReverbScT() {}
+    ~ReverbScT() {}
     /** Initializes the reverb module, and sets the sample_rate at which the Process function will be called.
         Returns 0 if all good, or 1 if it runs out of delay times exceed maximum allowed.
     */
@@ -45,6 +57,19 @@ class ReverbSc
     */
     int Process(const float &in1, const float &in2, float *out1, float *out2);
 
+    /** Processes a block of samples. The damping coefficient is updated once per block.
+        The eight delay lines' interpolation, feedback and damping run in
+        SIMD lanes, so the output differs from Process by rounding only.
+        \param in1, in2 - input signals
+        \param out1, out2 - output buffers, may be the same as the inputs
+        \param size - number of samples to process
+    */
+    int ProcessBlock(const float *in1,
+                     const float *in2,
+                     float *      out1,
+                     float *      out2,
+                     size_t       size);
+
     /** controls the reverb time. reverb tail becomes infinite when set to 1.0
         \param fb - sets reverb time. range: 0.0 to 1.0
     */
@@ -54,19 +79,41 @@ class ReverbSc
     */
     inline void SetLpFreq(const float &freq) { lpfreq_ = freq; }
 
+    /** The lowpass state of a delay line, for inspecting the reverb's memory.
+        \param n - delay line, 0 to 7
+    */
+    inline float GetFilterState(int n) const { return delay_lines_[n].filter_state; }
+
   private:
-    void       NextRandomLineseg(ReverbScDl *lp, int n);
-    int        InitDelayLine(ReverbScDl *lp, int n);
-    float      feedback_, lpfreq_;
-    float      i_sample_rate_, i_pitch_mod_, i_skip_init_;
-    float      sample_rate_;
-    float      damp_fact_;
-    float      prv_lpfreq_;
-    int        init_done_;
-    ReverbScDl delay_lines_[8];
-    float      aux_[DSY_REVERBSC_MAX_SIZE];
+    typedef ReverbScDlT<Sample> DelayLine;
+
+    void      NextRandomLineseg(DelayLine *lp, int n);
+    void      UpdateDampFact();
+    void      ProcessFrame(float in1, float in2, float *out1, float *out2);
+    float     ReadTaps(DelayLine *lp,
+                       int        n,
+                       float *    vm1,
+                       float *    v0,
+                       float *    v1,
+                       float *    v2);
+    void      ReadTapsWrapped(DelayLine *lp,
+                              int        read_pos,
+                              float *    vm1,
+                              float *    v0,
+                              float *    v1,
+                              float *    v2);
+    int       InitDelayLine(DelayLine *lp, int n);
+    float     feedback_, lpfreq_;
+    float     i_sample_rate_, i_pitch_mod_, i_skip_init_;
+    float     sample_rate_;
+    float     damp_fact_;
+    float     prv_lpfreq_;
+    int       init_done_;
+    DelayLine delay_lines_[8];
+    Sample    aux_[DSY_REVERBSC_MAX_SIZE];
 };
 
+typedef ReverbScT<StorageFloat> ReverbSc;
 
 } // namespace daisysp
 #endif
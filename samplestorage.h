@@ -0,0 +1,54 @@
+#ifndef SAMPLESTORAGE_H
+#define SAMPLESTORAGE_H
+#include <stdint.h>
+#include <string.h>
+
+// Sample formats for delay memory. Each converts to and from float on every
+// write and read; the 16 bit ones halve the memory and SDRAM bandwidth.
+
+// 32 bit float, no conversion
+struct StorageFloat
+{
+    typedef float Sample;
+    static inline float load(Sample s) { return s; }
+    static inline Sample store(float x) { return x; }
+};
+
+// 16 bit fixed point over +-4. Delay lines carry input plus feedback, so
+// they need headroom above full scale.
+struct StorageInt16
+{
+    typedef int16_t Sample;
+    static inline float load(Sample s) { return s * (4.0f / 32768.0f); }
+    static inline Sample store(float x)
+    {
+        float s = x * (32768.0f / 4.0f);
+        s = s > 32767.0f ? 32767.0f : s;
+        s = s < -32768.0f ? -32768.0f : s;
+        // Offset to positive so truncating rounds to nearest without a branch
+        return (Sample)((int)(s + 32768.5f) - 32768);
+    }
+};
+
+// bfloat16, the top half of a float rounded to nearest. Same range as
+// float with an 8 bit mantissa.
+struct StorageBf16
+{
+    typedef uint16_t Sample;
+    static inline float load(Sample s)
+    {
+        uint32_t bits = (uint32_t)s << 16;
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+    static inline Sample store(float x)
+    {
+        uint32_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        bits += 0x7FFF + ((bits >> 16) & 1);
+        return (Sample)(bits >> 16);
+    }
+};
+
+#endif // SAMPLESTORAGE_H
@@ -0,0 +1,173 @@
+#ifndef SIMD_H
+#define SIMD_H
+#include <stdint.h>
+
+// Four float lanes with NEON, SSE or plain scalar code behind them.
+// The Daisy's Cortex-M7 has no NEON, so the firmware always gets the scalar
+// version; it keeps the same structure-of-arrays layout and operation order,
+// so both produce matching output. Define SYNTH_NO_SIMD to force it on hosts.
+
+#if !defined(SYNTH_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define SYNTH_SIMD_NEON
+#elif !defined(SYNTH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define SYNTH_SIMD_SSE
+#endif
+
+#define SIMD_LANES 4
+
+#if defined(SYNTH_SIMD_NEON)
+
+struct f32x4
+{
+    float32x4_t v;
+};
+
+inline f32x4 simdSet(float x) { return {vdupq_n_f32(x)}; }
+inline f32x4 simdLoad(const float *p) { return {vld1q_f32(p)}; }
+inline void simdStore(float *p, f32x4 a) { vst1q_f32(p, a.v); }
+inline f32x4 operator+(f32x4 a, f32x4 b) { return {vaddq_f32(a.v, b.v)}; }
+inline f32x4 operator-(f32x4 a, f32x4 b) { return {vsubq_f32(a.v, b.v)}; }
+inline f32x4 operator*(f32x4 a, f32x4 b) { return {vmulq_f32(a.v, b.v)}; }
+inline f32x4 simdMin(f32x4 a, f32x4 b) { return {vminq_f32(a.v, b.v)}; }
+inline f32x4 simdMax(f32x4 a, f32x4 b) { return {vmaxq_f32(a.v, b.v)}; }
+inline f32x4 simdAbs(f32x4 a) { return {vabsq_f32(a.v)}; }
+// Lane masks are all ones where the comparison holds
+inline f32x4 simdLess(f32x4 a, f32x4 b) { return {vreinterpretq_f32_u32(vcltq_f32(a.v, b.v))}; }
+inline f32x4 simdGreater(f32x4 a, f32x4 b) { return {vreinterpretq_f32_u32(vcgtq_f32(a.v, b.v))}; }
+inline f32x4 simdSelect(f32x4 mask, f32x4 a, f32x4 b)
+{
+    return {vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v)};
+}
+#if defined(__aarch64__)
+inline bool simdAny(f32x4 mask) { return vmaxvq_u32(vreinterpretq_u32_f32(mask.v)) != 0; }
+inline float simdSum(f32x4 a) { return vaddvq_f32(a.v); }
+inline f32x4 simdDiv(f32x4 a, f32x4 b) { return {vdivq_f32(a.v, b.v)}; }
+#else
+inline bool simdAny(f32x4 mask)
+{
+    uint32x4_t bits = vreinterpretq_u32_f32(mask.v);
+    uint32x2_t m = vorr_u32(vget_low_u32(bits), vget_high_u32(bits));
+    return (vget_lane_u32(m, 0) | vget_lane_u32(m, 1)) != 0;
+}
+inline float simdSum(f32x4 a)
+{
+    float32x2_t s = vadd_f32(vget_low_f32(a.v), vget_high_f32(a.v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+// ARMv7 NEON has no divide, refine the reciprocal estimate twice
+inline f32x4 simdDiv(f32x4 a, f32x4 b)
+{
+    float32x4_t r = vrecpeq_f32(b.v);
+    r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+    r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+    return {vmulq_f32(a.v, r)};
+}
+#endif
+
+#elif defined(SYNTH_SIMD_SSE)
+
+struct f32x4
+{
+    __m128 v;
+};
+
+inline f32x4 simdSet(float x) { return {_mm_set1_ps(x)}; }
+inline f32x4 simdLoad(const float *p) { return {_mm_loadu_ps(p)}; }
+inline void simdStore(float *p, f32x4 a) { _mm_storeu_ps(p, a.v); }
+inline f32x4 operator+(f32x4 a, f32x4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline f32x4 operator-(f32x4 a, f32x4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline f32x4 operator*(f32x4 a, f32x4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline f32x4 simdMin(f32x4 a, f32x4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline f32x4 simdMax(f32x4 a, f32x4 b) { return {_mm_max_ps(a.v, b.v)}; }
+inline f32x4 simdAbs(f32x4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline f32x4 simdLess(f32x4 a, f32x4 b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+inline f32x4 simdGreater(f32x4 a, f32x4 b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+inline f32x4 simdSelect(f32x4 mask, f32x4 a, f32x4 b)
+{
+    return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+}
+inline bool simdAny(f32x4 mask) { return _mm_movemask_ps(mask.v) != 0; }
+inline float simdSum(f32x4 a)
+{
+    __m128 s = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+    return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+}
+inline f32x4 simdDiv(f32x4 a, f32x4 b) { return {_mm_div_ps(a.v, b.v)}; }
+
+#else
+
+#define SYNTH_SIMD_SCALAR
+
+struct f32x4
+{
+    float v[SIMD_LANES];
+};
+
+inline f32x4 simdSet(float x) { return {{x, x, x, x}}; }
+inline f32x4 simdLoad(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void simdStore(float *p, f32x4 a)
+{
+    for (int i = 0; i < SIMD_LANES; i++)
+    {
+        p[i] = a.v[i];
+    }
+}
+
+#define SIMD_SCALAR_OP(expr)             \
+    f32x4 r;                             \
+    for (int i = 0; i < SIMD_LANES; i++) \
+    {                                    \
+        r.v[i] = (expr);                 \
+    }                                    \
+    return r;
+
+inline f32x4 operator+(f32x4 a, f32x4 b) { SIMD_SCALAR_OP(a.v[i] + b.v[i]) }
+inline f32x4 operator-(f32x4 a, f32x4 b) { SIMD_SCALAR_OP(a.v[i] - b.v[i]) }
+inline f32x4 operator*(f32x4 a, f32x4 b) { SIMD_SCALAR_OP(a.v[i] * b.v[i]) }
+inline f32x4 simdMin(f32x4 a, f32x4 b) { SIMD_SCALAR_OP(a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+inline f32x4 simdMax(f32x4 a, f32x4 b) { SIMD_SCALAR_OP(a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+inline f32x4 simdAbs(f32x4 a) { SIMD_SCALAR_OP(a.v[i] < 0.0f ? -a.v[i] : a.v[i]) }
+// Masks are 1 or 0 per lane here, simdSelect is the only consumer
+inline f32x4 simdLess(f32x4 a, f32x4 b) { SIMD_SCALAR_OP(a.v[i] < b.v[i] ? 1.0f : 0.0f) }
+inline f32x4 simdGreater(f32x4 a, f32x4 b) { SIMD_SCALAR_OP(a.v[i] > b.v[i] ? 1.0f : 0.0f) }
+inline f32x4 simdSelect(f32x4 mask, f32x4 a, f32x4 b) { SIMD_SCALAR_OP(mask.v[i] != 0.0f ? a.v[i] : b.v[i]) }
+inline bool simdAny(f32x4 mask)
+{
+    return mask.v[0] != 0.0f || mask.v[1] != 0.0f || mask.v[2] != 0.0f || mask.v[3] != 0.0f;
+}
+// Same pairing as the SSE and ARMv7 versions
+inline float simdSum(f32x4 a) { return (a.v[0] + a.v[2]) + (a.v[1] + a.v[3]); }
+inline f32x4 simdDiv(f32x4 a, f32x4 b) { SIMD_SCALAR_OP(a.v[i] / b.v[i]) }
+
+#undef SIMD_SCALAR_OP
+
+#endif
+
+inline f32x4 operator+=(f32x4 &a, f32x4 b) { return a = a + b; }
+inline f32x4 operator*=(f32x4 &a, f32x4 b) { return a = a * b; }
+
+// sin(2 * pi * phase) for phase in [0, 1), within 4e-6 of sinf
+inline f32x4 simdSinPhase(f32x4 phase)
+{
+    // Map to z in [-1, 1) so the result is sin(pi * z), then fold into [-0.5, 0.5]
+    f32x4 z = phase * simdSet(2.0f) - simdSet(1.0f);
+    f32x4 a = simdAbs(z);
+    f32x4 sign = simdSelect(simdLess(z, simdSet(0.0f)), simdSet(-1.0f), simdSet(1.0f));
+    z = simdSelect(simdGreater(a, simdSet(0.5f)), (simdSet(1.0f) - a) * sign, z);
+
+    // Taylor series of sin(x) to x^9, x = pi * z
+    f32x4 x = z * simdSet(3.14159265f);
+    f32x4 x2 = x * x;
+    f32x4 p = simdSet(1.0f / 362880.0f);
+    p = p * x2 - simdSet(1.0f / 5040.0f);
+    p = p * x2 + simdSet(1.0f / 120.0f);
+    p = p * x2 - simdSet(1.0f / 6.0f);
+    p = p * x2 + simdSet(1.0f);
+
+    // sin(2 pi phase) = -sin(pi z)
+    return simdSet(0.0f) - p * x;
+}
+
+#endif // SIMD_H
@@ -0,0 +1,123 @@
+#ifndef STEREODELAY_H
+#define STEREODELAY_H
+#include <math.h>
+#include <stddef.h>
+#include "denormal.h"
+#include "samplestorage.h"
+
+// Per-sample one-pole coefficient the delay time glides with
+#define STEREODELAY_SMOOTHING 0.00007f
+// Block sizes the per-block smoothing is tabulated for, the engine's
+// SYNTH_MAX_BLOCK. Events split blocks into segments of any size up to it.
+#define STEREODELAY_MAX_BLOCK 64
+
+// Stereo feedback delay that works a block at a time. The delay time moves
+// towards its target once per block and ramps linearly across the block,
+// the read heads interpolate between samples. Cross feedback sends each
+// side's repeats to the other side, 1 gives a ping-pong delay.
+template <typename Storage, size_t MaxDelay>
+class StereoDelay
+{
+public:
+    typedef typename Storage::Sample Sample;
+
+    StereoDelay() {}
+    ~StereoDelay() {}
+
+    // Clears the buffers and starts at delay samples without gliding
+    void initialize(float delay)
+    {
+        for (size_t i = 0; i < MaxDelay; i++)
+        {
+            buffer_[0][i] = buffer_[1][i] = Storage::store(0.0f);
+        }
+
+        writePos_ = 0;
+        delay_ = target_ = clampDelay(delay);
+        feedback_ = 0.5f;
+        cross_ = 0.0f;
+
+        // What the per-sample coefficient adds up to over each block size
+        for (size_t n = 0; n <= STEREODELAY_MAX_BLOCK; n++)
+        {
+            blockSmoothing_[n] = 1.0f - powf(1.0f - STEREODELAY_SMOOTHING, (float)n);
+        }
+    }
+
+    // Delay in samples, the delay glides there over the following blocks
+    void setDelay(float delay) { target_ = clampDelay(delay); }
+    void setFeedback(float feedback) { feedback_ = feedback; }
+    void setCrossFeedback(float cross) { cross_ = cross; }
+
+    // The sample written to a channel age samples before the latest, for
+    // inspecting the delay memory
+    float getWritten(int channel, size_t age) const
+    {
+        return Storage::load(buffer_[channel][(writePos_ + MaxDelay - 1 - age) % MaxDelay]);
+    }
+
+    // Adds the delayed signal to left and right and feeds the result back
+    void processBlock(float *left, float *right, size_t size)
+    {
+        const float smoothing = size <= STEREODELAY_MAX_BLOCK
+                                    ? blockSmoothing_[size]
+                                    : 1.0f - expf(size * logf(1.0f - STEREODELAY_SMOOTHING));
+
+        const float start = delay_;
+        delay_ += (target_ - delay_) * smoothing;
+        const float step = (delay_ - start) / size;
+        const float feedback = feedback_;
+        const float cross = cross_;
+        Sample *bufferLeft = buffer_[0];
+        Sample *bufferRight = buffer_[1];
+        size_t writePos = writePos_;
+        float delay = start;
+
+        for (size_t i = 0; i < size; i++)
+        {
+            delay += step;
+
+            // Sample written k samples ago and the one before it
+            size_t k = (size_t)delay;
+            float frac = delay - k;
+            size_t a = writePos >= k ? writePos - k : writePos + MaxDelay - k;
+            size_t b = a > 0 ? a - 1 : MaxDelay - 1;
+
+            float aLeft = Storage::load(bufferLeft[a]);
+            float aRight = Storage::load(bufferRight[a]);
+            float wetLeft = aLeft + (Storage::load(bufferLeft[b]) - aLeft) * frac;
+            float wetRight = aRight + (Storage::load(bufferRight[b]) - aRight) * frac;
+
+            left[i] += feedback * (wetLeft + cross * (wetRight - wetLeft));
+            right[i] += feedback * (wetRight + cross * (wetLeft - wetRight));
+
+            // The DC keeps the feedback from decaying into subnormals, only
+            // the delay memory carries it
+            bufferLeft[writePos] = Storage::store(left[i] + SYNTH_DENORMAL_DC);
+            bufferRight[writePos] = Storage::store(right[i] + SYNTH_DENORMAL_DC);
+            if (++writePos >= MaxDelay)
+            {
+                writePos = 0;
+            }
+        }
+
+        writePos_ = writePos;
+    }
+
+private:
+    Sample buffer_[2][MaxDelay];
+    size_t writePos_;
+    float delay_;
+    float target_;
+    float feedback_;
+    float cross_;
+    float blockSmoothing_[STEREODELAY_MAX_BLOCK + 1];
+
+    static float clampDelay(float delay)
+    {
+        // The interpolation reads one sample further back
+        return delay < 1.0f ? 1.0f : (delay > MaxDelay - 2 ? MaxDelay - 2 : delay);
+    }
+};
+
+#endif // STEREODELAY_H
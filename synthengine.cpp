@@ -0,0 +1,861 @@
+#include "synthengine.h"
+#include "daisysp.h"
+
+using namespace daisysp;
+
+// CC 96 spans the profiles, 127 picks the last one
+static const int maxProfile = __P_COUNT - 1;
+
+static_assert(POLYSYNTH_VOICES <= VOICEBANK_MAX_VOICES, "VoiceBank is too small for POLYSYNTH_VOICES");
+static_assert(POLYSYNTH_VOICES <= MOOGLADDERBANK_MAX_VOICES, "MoogLadderBank is too small for POLYSYNTH_VOICES");
+static_assert(POLYSYNTH_VOICES <= ENVELOPEBANK_MAX_VOICES, "EnvelopeBank is too small for POLYSYNTH_VOICES");
+static_assert(POLYSYNTH_VOICES <= VOICEALLOCATOR_MAX_VOICES, "VoiceAllocator is too small for POLYSYNTH_VOICES");
+static_assert(SYNTH_MAX_BLOCK <= STEREODELAY_MAX_BLOCK, "StereoDelay's smoothing table is too small for SYNTH_MAX_BLOCK");
+static_assert(__PARAM_COUNT <= PARAMSTORE_MAX_PARAMS, "ParamStore is too small for EngineParam");
+
+// Key tracking is relative to middle C
+#define KEY_TRACKING_CENTER 261.63f
+// Cutoff range of the voice envelope at full filter envelope amount
+#define FILTER_ENV_OCTAVES 5.0f
+
+// LFO rate for a CC, 0.1 Hz to 20 Hz on a log scale
+static float lfoRate(float normalized)
+{
+    return 0.1f * fastExp2(normalized * 7.64386f);
+}
+
+SynthEngine::SynthEngine() {}
+SynthEngine::~SynthEngine() {}
+
+void SynthEngine::initialize(float sampleRate, EngineMemory *memory)
+{
+    memory_ = memory;
+    sampleRate_ = sampleRate;
+    sampleTime_.store(0);
+    reverbMix_ = 0.5f;
+    useWavetables_ = false;
+
+    memory_->wavetables.initialize();
+
+    filter.Init(sampleRate);
+
+    // Set filter parameters
+    filterCutoff_ = 10000.0f;
+    filterResonance_ = 0.8f;
+    keyTracking_ = 0.0f;
+    filterEnvAmount_ = 0.0f;
+    perVoiceFilter_ = false;
+    pitchBend_ = 0.0f;
+    lastNote_ = -1;
+    modCutoff_ = filterCutoff_;
+    modSlot_ = 0;
+    filter.SetFreq(filterCutoff_);
+    filter.SetRes(filterResonance_);
+    filterRight_.Init(sampleRate);
+    filterRight_.SetFreq(filterCutoff_);
+    filterRight_.SetRes(filterResonance_);
+    setFilterOversampling(SYNTH_FILTER_OVERSAMPLING);
+    filterBank.initialize(sampleRate);
+    envelopes.initialize(sampleRate);
+
+    memory_->reverb.Init(sampleRate);
+    memory_->reverb.SetLpFreq(18000.0f);
+    memory_->reverb.SetFeedback(0.85f);
+
+    memory_->delay.initialize(sampleRate * 0.75f);
+    memory_->delay.setFeedback(0.5f);
+
+    useVoiceBank = true;
+    loadMeter = nullptr;
+    denormalCounter = nullptr;
+    flushDenormals = true;
+    jobRunner = nullptr;
+    voiceBank.initialize(sampleRate);
+    numActiveVoices_ = 0;
+    modMatrix.initialize(sampleRate);
+    modMatrix.setLfoRate(MOD_LFO1, 0.1f);
+
+    for (int i = 0; i < POLYSYNTH_VOICES; i++)
+    {
+        voices[i].initialize(sampleRate, &memory_->wavetables);
+        voiceOut_[i] = voiceBuffers_[i];
+        voiceOutRight_[i] = voiceBuffersRight_[i];
+        envelopeOut_[i] = envelopeBuffers_[i];
+        velocity_[i] = 0.0f;
+        modGain_[i] = 1.0f;
+        for (int d = 0; d < __MOD_DESTINATION_COUNT; d++)
+        {
+            voiceMod_[i][d] = 0.0f;
+        }
+        syncVoiceBank(i);
+    }
+    allocator.initialize(voices, POLYSYNTH_VOICES);
+    governor.initialize(SYNTH_MIN_VOICES, POLYSYNTH_VOICES);
+
+    // Start from the values set above, so nothing is dirty yet. The
+    // envelope times are only pushed to the EnvelopeBank once a CC sets them.
+    const float smoothing = SYNTH_PARAM_SMOOTHING;
+    params_.initialize(sampleRate);
+    params_.define(PARAM_CUTOFF, 69.0f + 12.0f * log2f(filterCutoff_ / 440.0f), smoothing);
+    params_.define(PARAM_RESONANCE, filterResonance_, smoothing);
+    params_.define(PARAM_KEY_TRACKING, keyTracking_, smoothing);
+    params_.define(PARAM_FILTER_ENV, filterEnvAmount_, smoothing);
+    params_.define(PARAM_DETUNE, voices[0].detune, smoothing);
+    params_.define(PARAM_ATTACK, 0.0f, 0.0f);
+    params_.define(PARAM_DECAY, 0.0f, 0.0f);
+    params_.define(PARAM_SUSTAIN, 0.0f, 0.0f);
+    params_.define(PARAM_RELEASE, 0.0f, 0.0f);
+    params_.define(PARAM_LFO_FREQ, 0.1f, 0.0f);
+    params_.define(PARAM_LFO_AMP, 0.0f, smoothing);
+    params_.define(PARAM_PITCH_BEND, 0.0f, smoothing);
+    params_.define(PARAM_GLIDE, 0.0f, 0.0f);
+    params_.define(PARAM_REVERB_MIX, reverbMix_, smoothing);
+    params_.define(PARAM_REVERB_FEEDBACK, 0.85f, smoothing);
+    params_.define(PARAM_DELAY_FEEDBACK, 0.5f, smoothing);
+    params_.define(PARAM_DELAY_TIME, 0.75f, 0.0f);
+    params_.define(PARAM_DELAY_CROSS, 0.0f, smoothing);
+    params_.define(PARAM_UNISON_DETUNE, 0.25f, smoothing);
+    params_.define(PARAM_UNISON_SPREAD, 1.0f, smoothing);
+
+    unison_ = 1;
+    updateUnison();
+}
+
+void SynthEngine::setUseWavetables(bool enabled)
+{
+    useWavetables_ = enabled;
+
+    for (int i = 0; i < POLYSYNTH_VOICES; i++)
+    {
+        voices[i].useWavetables = enabled;
+    }
+}
+
+void SynthEngine::setPerVoiceFilter(bool enabled)
+{
+    if (enabled && !perVoiceFilter_)
+    {
+        for (int i = 0; i < POLYSYNTH_VOICES; i++)
+        {
+            filterBank.reset(i);
+        }
+    }
+
+    perVoiceFilter_ = enabled;
+}
+
+void SynthEngine::updateUnison()
+{
+    float detune = params_.get(PARAM_UNISON_DETUNE);
+    float spread = params_.get(PARAM_UNISON_SPREAD);
+
+    for (int i = 0; i < POLYSYNTH_VOICES; i++)
+    {
+        voices[i].setUnison(unison_, detune, spread);
+    }
+}
+
+void SynthEngine::setFilterOversampling(int factor)
+{
+    filter.SetOversampling(factor);
+    filterRight_.SetOversampling(factor);
+}
+
+void SynthEngine::syncVoiceBank(int voice)
+{
+    SynthVoice &v = voices[voice];
+    voiceBank.setVoice(voice, v.getFrequency() * v.getPitchRatio(), v.detune * v.getDetuneRatio());
+}
+
+void SynthEngine::updateModulation(size_t size)
+{
+    modMatrix.beginBlock(size);
+
+    for (int a = 0; a < numActiveVoices_; a++)
+    {
+        int v = activeVoices_[a];
+        float *mod = voiceMod_[v];
+
+        modMatrix.evaluate(v, voices[v].level, velocity_[v], size, mod);
+        if (voices[v].updatePitch(pitchBend_ + mod[MOD_PITCH], mod[MOD_DETUNE], size))
+        {
+            syncVoiceBank(v);
+        }
+    }
+
+    // The global filter runs on the mix, so only global routes reach it
+    float cutoff = filterCutoff_ * fastExp2(modMatrix.getGlobal(MOD_CUTOFF));
+    cutoff = fclamp(cutoff, 20.0f, sampleRate_ * 0.45f);
+    if (cutoff != modCutoff_)
+    {
+        modCutoff_ = cutoff;
+        filter.SetFreq(cutoff);
+        filterRight_.SetFreq(cutoff);
+    }
+}
+
+bool SynthEngine::postEvent(const EngineEvent &event)
+{
+    return events_.push(event);
+}
+
+void SynthEngine::dispatchEvent(const EngineEvent &event)
+{
+    int millis = (int)(event.time / (sampleRate_ / 1000.0f));
+
+    switch (event.status & 0xf0)
+    {
+    case 0x90:
+        if (event.data1 > 0)
+        {
+            handleNoteOn(event.data0, event.data1, millis);
+            break;
+        }
+        // Note on with velocity 0 is a note off
+        handleNoteOff(event.data0);
+        break;
+    case 0x80:
+        handleNoteOff(event.data0);
+        break;
+    case 0xb0:
+        handleControlChange(event.data0, event.data1);
+        break;
+    case 0xe0:
+    {
+        // 14 bits, LSB first, 8192 is the wheel at rest
+        int bend = ((event.data1 << 7) | event.data0) - 8192;
+        params_.set(PARAM_PITCH_BEND, bend * (SYNTH_PITCH_BEND_RANGE / 8192.0f));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+size_t SynthEngine::beginSegment(size_t size)
+{
+    uint32_t now = sampleTime_.load(std::memory_order_relaxed);
+    size_t n = size < SYNTH_MAX_BLOCK ? size : SYNTH_MAX_BLOCK;
+
+    while (const EngineEvent *event = events_.peek())
+    {
+        // Signed so the comparison survives the clock wrapping
+        int32_t offset = (int32_t)(event->time - now);
+
+        if (offset > 0)
+        {
+            if ((size_t)offset < n)
+            {
+                n = offset;
+            }
+            break;
+        }
+
+        dispatchEvent(*event);
+        events_.pop();
+    }
+
+    updateParams(n);
+    updateModulation(n);
+
+    sampleTime_.store(now + n, std::memory_order_relaxed);
+    return n;
+}
+
+void SynthEngine::updateParams(size_t size)
+{
+    params_.update(size);
+
+    uint32_t dirty = params_.takeDirty();
+    while (dirty)
+    {
+        applyParam(__builtin_ctz(dirty));
+        dirty &= dirty - 1;
+    }
+}
+
+void SynthEngine::applyParam(int param)
+{
+    float value = params_.get(param);
+
+    switch (param)
+    {
+    case PARAM_CUTOFF:
+        // updateModulation passes it on to the filters
+        filterCutoff_ = fastMtof(value);
+        break;
+    case PARAM_RESONANCE:
+        filterResonance_ = value;
+        filter.SetRes(filterResonance_);
+        filterRight_.SetRes(filterResonance_);
+        break;
+    case PARAM_KEY_TRACKING:
+        keyTracking_ = value;
+        break;
+    case PARAM_FILTER_ENV:
+        filterEnvAmount_ = value;
+        break;
+    case PARAM_DETUNE:
+        for (int i = 0; i < POLYSYNTH_VOICES; i++)
+        {
+            voices[i].detune = value;
+            voices[i].setFrequency();
+            syncVoiceBank(i);
+        }
+        break;
+    case PARAM_ATTACK:
+        envelopes.setTime(ENVELOPE_ATTACK, value);
+        break;
+    case PARAM_DECAY:
+        envelopes.setTime(ENVELOPE_DECAY, value);
+        break;
+    case PARAM_SUSTAIN:
+        envelopes.setSustainLevel(value);
+        break;
+    case PARAM_RELEASE:
+        envelopes.setTime(ENVELOPE_RELEASE, value);
+        break;
+    case PARAM_LFO_FREQ:
+        modMatrix.setLfoRate(MOD_LFO1, value);
+        break;
+    case PARAM_LFO_AMP:
+        modMatrix.setRoute(SYNTH_VIBRATO_ROUTE, MOD_LFO1, MOD_PITCH, value / modDestinationRange[MOD_PITCH]);
+        break;
+    case PARAM_PITCH_BEND:
+        pitchBend_ = value;
+        break;
+    case PARAM_GLIDE:
+        for (int i = 0; i < POLYSYNTH_VOICES; i++)
+        {
+            voices[i].setGlide(value);
+        }
+        break;
+    case PARAM_REVERB_MIX:
+        reverbMix_ = value;
+        break;
+    case PARAM_REVERB_FEEDBACK:
+        memory_->reverb.SetFeedback(value);
+        break;
+    case PARAM_DELAY_FEEDBACK:
+        memory_->delay.setFeedback(value);
+        break;
+    case PARAM_DELAY_TIME:
+        memory_->delay.setDelay(sampleRate_ * value);
+        break;
+    case PARAM_DELAY_CROSS:
+        memory_->delay.setCrossFeedback(value);
+        break;
+    case PARAM_UNISON_DETUNE:
+    case PARAM_UNISON_SPREAD:
+        updateUnison();
+        break;
+    default:
+        break;
+    }
+}
+
+void SynthEngine::handleNoteOn(int note, int velocity, int millis)
+{
+    if (note < 0 || note >= VOICEALLOCATOR_NOTES)
+    {
+        return;
+    }
+
+    int stolenNote;
+    int v = allocator.noteOn(note, stolenNote);
+
+    voices[v].setFrequency(fastMtof(note));
+    voices[v].note = note;
+    voices[v].lastNoteMs = millis;
+    envelopes.trigger(v);
+    velocity_[v] = velocity / 127.0f;
+    modMatrix.retrigger(v);
+    if (lastNote_ >= 0)
+    {
+        voices[v].glideFrom(lastNote_ - note);
+    }
+    lastNote_ = note;
+    syncVoiceBank(v);
+    activateVoice(v);
+}
+
+void SynthEngine::activateVoice(int voice)
+{
+    int i = numActiveVoices_;
+
+    while (i > 0 && activeVoices_[i - 1] >= voice)
+    {
+        if (activeVoices_[i - 1] == voice)
+        {
+            return;
+        }
+        i--;
+    }
+
+    for (int j = numActiveVoices_; j > i; j--)
+    {
+        activeVoices_[j] = activeVoices_[j - 1];
+    }
+    activeVoices_[i] = voice;
+    numActiveVoices_++;
+
+    // Don't let the filter ring on from the voice's previous note
+    filterBank.reset(voice);
+}
+
+void SynthEngine::updateVoiceLimit(float load, float voiceLoad)
+{
+    allocator.setVoiceLimit(governor.update(load, voiceLoad, numActiveVoices_));
+
+    int stolenNote;
+    int v;
+    while ((v = allocator.shedVoice(stolenNote)) >= 0)
+    {
+        // Fade out instead of leaving the mix mid-waveform. The voice stays
+        // active until deactivateIdleVoices finds its envelope idle, a note
+        // that takes it first retriggers it from where the fade is.
+        voices[v].release();
+        envelopes.fadeOut(v);
+    }
+}
+
+void SynthEngine::deactivateIdleVoices()
+{
+    int kept = 0;
+
+    for (int a = 0; a < numActiveVoices_; a++)
+    {
+        int v = activeVoices_[a];
+        if (voices[v].note > -1 || !envelopes.isIdle(v))
+        {
+            activeVoices_[kept++] = v;
+        }
+        else
+        {
+            allocator.voiceIdle(v);
+        }
+    }
+
+    numActiveVoices_ = kept;
+}
+
+void SynthEngine::handleNoteOff(int note)
+{
+    if (note < 0 || note >= VOICEALLOCATOR_NOTES)
+    {
+        return;
+    }
+
+    int v = allocator.noteOff(note);
+
+    if (v >= 0)
+    {
+        voices[v].release();
+        envelopes.release(v);
+    }
+}
+
+void SynthEngine::handleControlChange(int control, int value)
+{
+    float normalized = (float)value / 127.0f;
+
+    switch (control)
+    {
+    case 96: // set voice profile
+    {
+        Profile profile = static_cast<Profile>(round(normalized * maxProfile));
+        voiceBank.setProfile(profile);
+        for (int i = 0; i < POLYSYNTH_VOICES; i++)
+        {
+            voices[i].setProfile(profile);
+            syncVoiceBank(i);
+        }
+        // The profile brings its own detune
+        params_.jump(PARAM_DETUNE, voices[0].detune);
+    }
+    break;
+    case 105: // detune voices
+        params_.set(PARAM_DETUNE, normalized * 4.0f);
+        break;
+    case 103: // Oscillator engine, naive or band-limited wavetables
+        setUseWavetables(value >= 64);
+        break;
+    case 97: // Cutoff
+        params_.set(PARAM_CUTOFF, (float)value);
+        break;
+    case 106: // Resonance
+        params_.set(PARAM_RESONANCE, normalized);
+        break;
+    case 104: // Filter mode, one filter on the mix or one per voice
+        setPerVoiceFilter(value >= 64);
+        break;
+    case 112: // Filter key tracking, per-voice mode only
+        params_.set(PARAM_KEY_TRACKING, normalized);
+        break;
+    case 113: // Filter envelope amount, per-voice mode only
+        params_.set(PARAM_FILTER_ENV, normalized);
+        break;
+    case 98: // Attack
+        params_.set(PARAM_ATTACK, normalized * 2.0f);
+        break;
+    case 107: // Decay
+        params_.set(PARAM_DECAY, normalized);
+        break;
+    case 99: // Sustain
+        params_.set(PARAM_SUSTAIN, normalized);
+        break;
+    case 108: // Release
+        params_.set(PARAM_RELEASE, normalized);
+        break;
+    case 100: // Vibrato rate, 0.1 Hz to 20 Hz
+        params_.set(PARAM_LFO_FREQ, lfoRate(normalized));
+        break;
+    case 109: // Vibrato depth
+        params_.set(PARAM_LFO_AMP, normalized * SYNTH_VIBRATO_DEPTH_MAX);
+        break;
+    case 118: // Glide time, 0 is off
+        params_.set(PARAM_GLIDE, normalized * normalized * SYNTH_GLIDE_MAX);
+        break;
+    case 93: // LFO 2 rate
+        modMatrix.setLfoRate(MOD_LFO2, lfoRate(normalized));
+        break;
+    case 94: // Voice LFO rate
+        modMatrix.setLfoRate(MOD_VOICE_LFO, lfoRate(normalized));
+        break;
+    case 89: // Mod matrix slot CC 90 to 92 edit
+        modSlot_ = value * MODMATRIX_ROUTES / 128;
+        break;
+    case 90: // Mod source, a ModSource
+    {
+        const ModRoute &route = modMatrix.getRoute(modSlot_);
+        modMatrix.setRoute(modSlot_, value, route.destination, route.amount);
+        break;
+    }
+    case 91: // Mod destination, a ModDestination
+    {
+        const ModRoute &route = modMatrix.getRoute(modSlot_);
+        modMatrix.setRoute(modSlot_, route.source, value, route.amount);
+        break;
+    }
+    case 92: // Mod amount, 64 is none
+    {
+        const ModRoute &route = modMatrix.getRoute(modSlot_);
+        modMatrix.setRoute(modSlot_, route.source, route.destination, (value - 64) / 63.0f);
+        break;
+    }
+    case 101: // Reverb mix
+        params_.set(PARAM_REVERB_MIX, normalized);
+        break;
+    case 110: // Reverb feedback
+        params_.set(PARAM_REVERB_FEEDBACK, normalized);
+        break;
+    case 102: // Delay feedback
+        params_.set(PARAM_DELAY_FEEDBACK, normalized);
+        break;
+    case 111: // Delay time
+        params_.set(PARAM_DELAY_TIME, normalized);
+        break;
+    case 114: // Delay cross feedback, 127 is ping-pong
+        params_.set(PARAM_DELAY_CROSS, normalized);
+        break;
+    case 115: // Unison oscillators per voice, 0 is off
+        unison_ = 1 + value * SYNTHVOICE_MAX_UNISON / 128;
+        updateUnison();
+        break;
+    case 116: // Unison detune
+        params_.set(PARAM_UNISON_DETUNE, normalized * SYNTH_UNISON_DETUNE_MAX);
+        break;
+    case 117: // Unison stereo spread
+        params_.set(PARAM_UNISON_SPREAD, normalized);
+        break;
+    default:
+        break;
+    }
+}
+
+void SynthEngine::renderVoices(float *left, float *right, size_t size)
+{
+    int numJobs = 0;
+
+    for (int a = 0; a < numActiveVoices_; a++)
+    {
+        int group = activeVoices_[a] / SIMD_LANES;
+
+        if (numJobs > 0 && activeVoices_[voiceJobs_[numJobs - 1].first] / SIMD_LANES == group)
+        {
+            voiceJobs_[numJobs - 1].count++;
+        }
+        else
+        {
+            voiceJobs_[numJobs].first = a;
+            voiceJobs_[numJobs].count = 1;
+            numJobs++;
+        }
+    }
+
+    jobSize_ = size;
+    if (jobRunner && numJobs > 1)
+    {
+        jobRunner->run(numJobs, renderVoiceJob, this);
+    }
+    else
+    {
+        for (int j = 0; j < numJobs; j++)
+        {
+            renderVoiceJob(this, j);
+        }
+    }
+
+    mixVoices(voiceBuffers_, left, size);
+    if (isStereo())
+    {
+        mixVoices(voiceBuffersRight_, right, size);
+    }
+    if (denormalCounter && perVoiceFilter_)
+    {
+        for (int s = 0; s < 6; s++)
+        {
+            countDenormals(LOAD_VOICES, filterBank.getState(s), POLYSYNTH_VOICES);
+        }
+    }
+
+    deactivateIdleVoices();
+}
+
+void SynthEngine::renderVoiceJob(void *context, int index)
+{
+    // The floating point mode is per thread, so jobs on a runner's
+    // threads need their own guard
+    SynthEngine *engine = static_cast<SynthEngine *>(context);
+    DenormalGuard guard(engine->flushDenormals);
+    const VoiceJob &job = engine->voiceJobs_[index];
+
+    engine->renderVoiceRun(&engine->activeVoices_[job.first], job.count, engine->jobSize_);
+}
+
+// Renders, and in per-voice filter mode filters, the given active voices.
+// Runs on any thread, so it only touches the voices' own state and buffers.
+void SynthEngine::renderVoiceRun(const int *active, int count, size_t size)
+{
+    envelopes.process(envelopeOut_, POLYSYNTH_VOICES, active, count, size);
+    for (int a = 0; a < count; a++)
+    {
+        voices[active[a]].level = envelopes.getLevel(active[a]);
+    }
+
+    if (unison_ > 1)
+    {
+        bool stereo = isStereo();
+        for (int a = 0; a < count; a++)
+        {
+            int v = active[a];
+            voices[v].renderUnison(envelopeOut_[v], voiceOut_[v], stereo ? voiceOutRight_[v] : nullptr, size);
+        }
+    }
+    else if (useVoiceBank && !useWavetables_)
+    {
+        voiceBank.render(envelopeOut_, voiceOut_, POLYSYNTH_VOICES, active, count, size);
+    }
+    else
+    {
+        for (int a = 0; a < count; a++)
+        {
+            int v = active[a];
+            voices[v].render(envelopeOut_[v], voiceOut_[v], size);
+        }
+    }
+
+    for (int a = 0; a < count; a++)
+    {
+        applyModGain(active[a], size);
+    }
+
+    if (perVoiceFilter_)
+    {
+        updateVoiceFilters(active, count);
+        filterBank.process(voiceOut_, POLYSYNTH_VOICES, active, count, size);
+    }
+}
+
+// Ramps a voice's buffers from the last block's amplitude modulation to
+// this one's, nothing to do while it stays at 1
+void SynthEngine::applyModGain(int voice, size_t size)
+{
+    float target = 1.0f + voiceMod_[voice][MOD_AMPLITUDE];
+    target = target > 0.0f ? target : 0.0f;
+
+    float gain = modGain_[voice];
+    if (gain == 1.0f && target == 1.0f)
+    {
+        return;
+    }
+
+    float *left = voiceOut_[voice];
+    float *right = isStereo() ? voiceOutRight_[voice] : nullptr;
+    const float step = (target - gain) / size;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        gain += step;
+        left[i] *= gain;
+        if (right)
+        {
+            right[i] *= gain;
+        }
+    }
+    modGain_[voice] = target;
+}
+
+void SynthEngine::mixVoices(float buffers[][SYNTH_MAX_BLOCK], float *out, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        out[i] = 0.0f;
+    }
+
+    for (int a = 0; a < numActiveVoices_; a++)
+    {
+        const float *voice = buffers[activeVoices_[a]];
+        for (size_t i = 0; i < size; i++)
+        {
+            out[i] += voice[i];
+        }
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        out[i] /= SYNTH_MIX_VOICES;
+    }
+}
+
+void SynthEngine::updateVoiceFilters(const int *active, int count)
+{
+    const float maxCutoff = sampleRate_ * 0.45f;
+
+    for (int a = 0; a < count; a++)
+    {
+        int v = active[a];
+        SynthVoice &voice = voices[v];
+
+        float cutoff = filterCutoff_;
+        if (keyTracking_ > 0.0f)
+        {
+            cutoff *= powf(voice.getFrequency() / KEY_TRACKING_CENTER, keyTracking_);
+        }
+        if (filterEnvAmount_ > 0.0f)
+        {
+            cutoff *= fastExp2(filterEnvAmount_ * voice.level * FILTER_ENV_OCTAVES);
+        }
+        if (modMatrix.isRouted(MOD_CUTOFF))
+        {
+            cutoff *= fastExp2(voiceMod_[v][MOD_CUTOFF]);
+        }
+        cutoff = fclamp(cutoff, 20.0f, maxCutoff);
+
+        filterBank.setVoice(v, cutoff, filterResonance_);
+    }
+}
+
+void SynthEngine::processFilter(float *left, float *right, size_t size)
+{
+    if (perVoiceFilter_)
+    {
+        return;
+    }
+
+    filter.ProcessBlock(left, size);
+    if (isStereo())
+    {
+        filterRight_.ProcessBlock(right, size);
+    }
+    countDenormals(LOAD_FILTER, filter.GetState(), 6);
+    if (isStereo())
+    {
+        countDenormals(LOAD_FILTER, filterRight_.GetState(), 6);
+    }
+}
+
+void SynthEngine::processReverb(const float *left, const float *right, float *out1, float *out2, size_t size)
+{
+    if (!isStereo())
+    {
+        right = left;
+    }
+
+    // Init fails if the sample rate needs more delay memory than the reverb has
+    if (memory_->reverb.ProcessBlock(left, right, out1, out2, size) != 0)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            out1[i] = left[i];
+            out2[i] = right[i];
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        out1[i] = reverbMix_ * out1[i] + (1 - reverbMix_) * left[i];
+        out2[i] = reverbMix_ * out2[i] + (1 - reverbMix_) * right[i];
+    }
+    if (denormalCounter)
+    {
+        float state[8];
+        for (int n = 0; n < 8; n++)
+        {
+            state[n] = memory_->reverb.GetFilterState(n);
+        }
+        countDenormals(LOAD_REVERB, state, 8);
+    }
+}
+
+void SynthEngine::processDelay(float *out1, float *out2, size_t size)
+{
+    memory_->delay.processBlock(out1, out2, size);
+    if (denormalCounter)
+    {
+        // The samples this segment wrote, as stored
+        float written[SYNTH_MAX_BLOCK];
+        for (int channel = 0; channel < 2; channel++)
+        {
+            for (size_t age = 0; age < size; age++)
+            {
+                written[age] = memory_->delay.getWritten(channel, age);
+            }
+            countDenormals(LOAD_DELAY, written, size);
+        }
+    }
+}
+
+void SynthEngine::process(float *out1, float *out2, size_t size)
+{
+    DenormalGuard guard(flushDenormals);
+
+    while (size > 0)
+    {
+        size_t n = beginSegment(size);
+        markLoad(LOAD_EVENTS);
+        if (loadMeter)
+        {
+            loadMeter->addVoiceSamples(numActiveVoices_, n);
+        }
+
+        renderVoices(signal_, signalRight_, n);
+        markLoad(LOAD_VOICES);
+        processFilter(signal_, signalRight_, n);
+        markLoad(LOAD_FILTER);
+        processReverb(signal_, signalRight_, out1, out2, n);
+        markLoad(LOAD_REVERB);
+        processDelay(out1, out2, n);
+        markLoad(LOAD_DELAY);
+
+        out1 += n;
+        out2 += n;
+        size -= n;
+    }
+
+    if (denormalCounter)
+    {
+        denormalCounter->endBlock();
+    }
+}
@@ -0,0 +1,302 @@
+#ifndef SYNTHENGINE_H
+#define SYNTHENGINE_H
+#include "daisysp.h"
+#include "denormal.h"
+#include "envelopebank.h"
+#include "eventqueue.h"
+#include "jobrunner.h"
+#include "loadmeter.h"
+#include "modmatrix.h"
+#include "moogladder.h"
+#include "moogladderbank.h"
+#include "paramstore.h"
+#include "pitch.h"
+#include "reverbsc.h"
+#include "stereodelay.h"
+#include "synthvoice.h"
+#include "voiceallocator.h"
+#include "voicebank.h"
+#include "voicegovernor.h"
+
+using namespace daisysp;
+
+// Voices there is memory for, the governor decides how many may sound.
+// Host builds may raise it up to the banks' 64.
+#ifndef POLYSYNTH_VOICES
+#define POLYSYNTH_VOICES 32
+#endif
+// The fewest voices the governor cuts down to
+#define SYNTH_MIN_VOICES 1
+// Voices at full level the mix is scaled for
+#define SYNTH_MIX_VOICES 8
+#define MAX_DELAY static_cast<size_t>(48000 * 2.5f)
+#define SYNTH_MAX_BLOCK 64
+#define SYNTH_EVENT_QUEUE_SIZE 256
+// Time the continuous controls glide over after a CC, in seconds
+#define SYNTH_PARAM_SMOOTHING 0.02f
+// Unison detune at full CC, in semitones either side of the note
+#define SYNTH_UNISON_DETUNE_MAX 1.0f
+// Pitch bend at full wheel and vibrato at full CC, in semitones
+#define SYNTH_PITCH_BEND_RANGE 2.0f
+#define SYNTH_VIBRATO_DEPTH_MAX 1.0f
+// ModMatrix slot CC 109 sets as LFO 1 to pitch, the other slots are free
+#define SYNTH_VIBRATO_ROUTE 0
+// Longest glide time at full CC, in seconds
+#define SYNTH_GLIDE_MAX 1.0f
+
+// Oversampling of the global ladder filter, 1, 2 or 4. 1 keeps the Daisy
+// within budget with every voice busy, offline renders can afford 4.
+#ifndef SYNTH_FILTER_OVERSAMPLING
+#define SYNTH_FILTER_OVERSAMPLING 1
+#endif
+
+// Delay memory formats of the reverb and delay, from samplestorage.h.
+// StorageInt16 or StorageBf16 halve their SDRAM footprint and bandwidth,
+// see host/bench reverbstorage and delay.
+#ifndef SYNTH_REVERB_STORAGE
+#define SYNTH_REVERB_STORAGE StorageFloat
+#endif
+#ifndef SYNTH_DELAY_STORAGE
+#define SYNTH_DELAY_STORAGE StorageFloat
+#endif
+
+typedef ReverbScT<SYNTH_REVERB_STORAGE> EngineReverb;
+typedef StereoDelay<SYNTH_DELAY_STORAGE, MAX_DELAY> EngineDelay;
+
+// Large DSP state that has to live in SDRAM on the Daisy.
+// The firmware places this in DSY_SDRAM_BSS, host builds just make it static.
+struct EngineMemory
+{
+    WavetableSet wavetables;
+    EngineReverb reverb;
+    EngineDelay delay;
+};
+
+// A MIDI channel message, stamped with the engine sample time it takes
+// effect at (see SynthEngine::getSampleTime)
+struct EngineEvent
+{
+    uint32_t time;
+    uint8_t status;
+    uint8_t data0;
+    uint8_t data1;
+};
+
+// Continuous controls, set by CCs and applied by the engine once per
+// segment, and only when they moved
+enum EngineParam
+{
+    PARAM_CUTOFF, // MIDI note, glides in pitch
+    PARAM_RESONANCE,
+    PARAM_KEY_TRACKING,
+    PARAM_FILTER_ENV,
+    PARAM_DETUNE,
+    PARAM_ATTACK,
+    PARAM_DECAY,
+    PARAM_SUSTAIN,
+    PARAM_RELEASE,
+    PARAM_LFO_FREQ, // LFO 1 rate in Hz
+    PARAM_LFO_AMP, // Vibrato depth in semitones, LFO 1 to pitch
+    PARAM_PITCH_BEND, // Semitones
+    PARAM_GLIDE, // Seconds
+    PARAM_REVERB_MIX,
+    PARAM_REVERB_FEEDBACK,
+    PARAM_DELAY_FEEDBACK,
+    PARAM_DELAY_TIME, // Seconds, the delay glides on its own
+    PARAM_DELAY_CROSS,
+    PARAM_UNISON_DETUNE, // Semitones either side
+    PARAM_UNISON_SPREAD,
+    __PARAM_COUNT
+};
+
+// Everything between MIDI in and audio out, without any Daisy hardware,
+// so the same code runs in the firmware and in host builds.
+class SynthEngine
+{
+public:
+    SynthEngine();
+    ~SynthEngine();
+
+    SynthVoice voices[POLYSYNTH_VOICES];
+    VoiceBank voiceBank;
+    MoogLadder filter;
+    MoogLadderBank filterBank;
+    // Every voice's amplitude envelope
+    EnvelopeBank envelopes;
+    // Note to voice assignment, stealing policy and counters
+    VoiceAllocator allocator;
+    // Sets the allocator's voice limit from the measured load
+    VoiceGovernor governor;
+    // LFOs, envelopes and velocity to pitch, cutoff, amplitude and detune.
+    // CC 89 to 92 edit its routes.
+    ModMatrix modMatrix;
+
+    // Render voices through the SIMD VoiceBank, or one SynthVoice at a time.
+    // The bank only covers the naive oscillators, wavetable voices always
+    // render one at a time.
+    bool useVoiceBank;
+
+    // When set, process() charges each stage's time to it and counts the
+    // active voices of each segment
+    LoadMeter *loadMeter;
+
+    // When set, each block stage counts the subnormals left in its filter,
+    // reverb or delay state to it, by LoadStage, and process() ends a block
+    // of the counter per call. A debug aid, see flushDenormals.
+    DenormalCounter *denormalCounter;
+
+    // Whether process() and the voice jobs run under a DenormalGuard. On by
+    // default, turned off only to see what the DSP lets through without it.
+    bool flushDenormals;
+
+    // When set, renderVoices hands it one job per SIMD lane group of active
+    // voices. Each job touches only its own voices, and the mix sums them in
+    // voice order afterwards, so the output does not depend on the runner.
+    JobRunner *jobRunner;
+
+    void initialize(float sampleRate, EngineMemory *memory);
+
+    // Queues an event for the audio thread, safe to call from one thread
+    // other than the one running process(). The event applies on the exact
+    // sample of its time, or at the next segment if that has passed.
+    // Returns false if the queue is full.
+    bool postEvent(const EngineEvent &event);
+
+    // Samples processed so far, the clock EngineEvent times are on
+    uint32_t getSampleTime() const { return sampleTime_.load(std::memory_order_relaxed); }
+
+    // Audio thread only, other threads go through postEvent
+    void handleNoteOn(int note, int velocity, int millis);
+    void handleNoteOff(int note);
+    void handleControlChange(int control, int value);
+
+    // Filter each voice on its own through filterBank, with key tracking
+    // and the voice envelope moving its cutoff, instead of filtering the mix
+    void setPerVoiceFilter(bool enabled);
+
+    // Runs the global filter at 1x, 2x or 4x the sample rate. The per-voice
+    // filters are not oversampled.
+    void setFilterOversampling(int factor);
+
+    // Block stages, size must not exceed SYNTH_MAX_BLOCK. Callers running
+    // them on their own hold a DenormalGuard around them, as process() does.
+    // In per-voice filter mode renderVoices also filters and processFilter
+    // does nothing.
+    // The voice mix is mono unless isStereo(), then right carries the right
+    // channel and left the left one; otherwise right is left untouched.
+    void renderVoices(float *left, float *right, size_t size);
+    void processFilter(float *left, float *right, size_t size);
+    void processReverb(const float *left, const float *right, float *out1, float *out2, size_t size);
+    void processDelay(float *out1, float *out2, size_t size);
+
+    // Unison spreads each voice's stack across the stereo field. Per-voice
+    // filtering runs on mono voices, so in that mode unison stays mono.
+    bool isStereo() const { return unison_ > 1 && !perVoiceFilter_; }
+
+    // Applies the events that are due, moves the smoothed parameters and
+    // returns how many samples, at most size and SYNTH_MAX_BLOCK, the stages
+    // can run before the next event. Advances the sample time by that many.
+    size_t beginSegment(size_t size);
+
+    // Runs the whole chain, any size, splitting it at event times
+    void process(float *out1, float *out2, size_t size);
+
+    // Voices that are holding a note or still releasing
+    int getActiveVoiceCount() const { return numActiveVoices_; }
+
+    // Feeds the last block's load and the voice stage's part of it, as
+    // fractions of the block's duration, to the governor and fades out the
+    // voices over its new limit, the ones a note would have stolen first,
+    // within ENVELOPEBANK_FADE_TIME. Call once per block between blocks.
+    void updateVoiceLimit(float load, float voiceLoad);
+
+private:
+    EngineMemory *memory_;
+    float sampleRate_;
+
+    EventQueue<EngineEvent, SYNTH_EVENT_QUEUE_SIZE> events_;
+    std::atomic<uint32_t> sampleTime_;
+    ParamStore params_;
+    float reverbMix_;
+    bool useWavetables_;
+
+    // Oscillators per voice, 1 is the plain oscillator pair
+    int unison_;
+
+    // Filter, filterRight_ only runs on a stereo mix
+    MoogLadder filterRight_;
+    bool perVoiceFilter_;
+    float filterCutoff_;
+    float filterResonance_;
+    float keyTracking_;
+    float filterEnvAmount_;
+
+    // Pitch bend in semitones and the last note played, glides start there
+    float pitchBend_;
+    int lastNote_;
+
+    // ModMatrix output per voice for the current block, and the note
+    // velocities it reads. Amplitude ramps from modGain_ across a block.
+    float voiceMod_[POLYSYNTH_VOICES][__MOD_DESTINATION_COUNT];
+    float velocity_[POLYSYNTH_VOICES];
+    float modGain_[POLYSYNTH_VOICES];
+    // Global filter cutoff with the global cutoff routes applied
+    float modCutoff_;
+    // Slot CC 90 to 92 edit
+    int modSlot_;
+
+    // Sounding voices in ascending order, idle voices are not rendered
+    int activeVoices_[POLYSYNTH_VOICES];
+    int numActiveVoices_;
+
+    // A run of activeVoices_ within one SIMD lane group, rendered as a unit
+    struct VoiceJob
+    {
+        int first;
+        int count;
+    };
+    VoiceJob voiceJobs_[POLYSYNTH_VOICES];
+    size_t jobSize_;
+
+    float voiceBuffers_[POLYSYNTH_VOICES][SYNTH_MAX_BLOCK];
+    float voiceBuffersRight_[POLYSYNTH_VOICES][SYNTH_MAX_BLOCK];
+    float *voiceOut_[POLYSYNTH_VOICES];
+    float *voiceOutRight_[POLYSYNTH_VOICES];
+    float envelopeBuffers_[POLYSYNTH_VOICES][SYNTH_MAX_BLOCK];
+    float *envelopeOut_[POLYSYNTH_VOICES];
+    float signal_[SYNTH_MAX_BLOCK];
+    float signalRight_[SYNTH_MAX_BLOCK];
+
+    void dispatchEvent(const EngineEvent &event);
+    void updateParams(size_t size);
+    void applyParam(int param);
+    void syncVoiceBank(int voice);
+    void updateModulation(size_t size);
+    void applyModGain(int voice, size_t size);
+    void activateVoice(int voice);
+    void deactivateIdleVoices();
+    void setUseWavetables(bool enabled);
+    static void renderVoiceJob(void *context, int index);
+    void renderVoiceRun(const int *active, int count, size_t size);
+    void updateVoiceFilters(const int *active, int count);
+    void updateUnison();
+    void mixVoices(float buffers[][SYNTH_MAX_BLOCK], float *out, size_t size);
+
+    void markLoad(int stage)
+    {
+        if (loadMeter)
+        {
+            loadMeter->mark(stage);
+        }
+    }
+
+    void countDenormals(int stage, const float *values, size_t size)
+    {
+        if (denormalCounter)
+        {
+            denormalCounter->count(stage, values, size);
+        }
+    }
+};
+
+#endif // SYNTHENGINE_H
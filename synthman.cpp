@@ -1,24 +1,35 @@
 #include "daisysp.h"
 #include "daisy_pod.h"
-#include "moogladder.h"
-#include "synthvoice.h"
+#include "synthengine.h"
 
 using namespace daisysp;
 using namespace daisy;
 
-#define NUM_NOTES 127
 #define NUM_OSCILLATORS 3
-#define POLYSYNTH_VOICES 8
-#define MAX_DELAY static_cast<size_t>(48000 * 2.5f)
+
+// Samples per audio callback. Larger blocks cost latency but spread the
+// per-block overhead over more samples; set it with make AUDIO_BLOCK_SIZE=n.
+#ifndef AUDIO_BLOCK_SIZE
+#define AUDIO_BLOCK_SIZE 16
+#endif
+
+// Knobs, encoder, buttons and LEDs are serviced this often from the main
+// loop, independent of the block size
+#define CONTROL_RATE_HZ 1000
+
+// PostKnob control that sends pitch bend instead of a CC
+#define KNOB_PITCH_BEND -1
 
 static DaisyPod pod;
-static MoogLadder filter;
 static Parameter pitchParam, osc2Detune, cutoffParam, resonanceParam, lfoParam;
-static ReverbSc DSY_SDRAM_BSS reverb;
-static DelayLine<float, MAX_DELAY> DSY_SDRAM_BSS delayLeft;
-static DelayLine<float, MAX_DELAY> DSY_SDRAM_BSS delayRight;
+static EngineMemory DSY_SDRAM_BSS engineMemory;
+static SynthEngine engine;
+static LoadMeter loadMeter;
 
-SynthVoice voices[POLYSYNTH_VOICES];
+// Written by the audio callback at the start of each block, read by the MIDI
+// loop to timestamp events. blockSampleTime is written last and read twice.
+static volatile uint32_t blockStartUs;
+static volatile uint32_t blockSampleTime;
 
 enum ControlMode
 {
@@ -30,7 +41,6 @@ enum ControlMode
 };
 
 int numWaveforms = static_cast<Waveform>(__WF_COUNT);
-int numProfiles = static_cast<Profile>(__WF_COUNT);
 
 ControlMode mode;
 int wave[NUM_OSCILLATORS];
@@ -44,14 +54,14 @@ float attack;
 float release;
 float cutoff;
 float resonance;
-float reverbMix;
-float oldKnob1, oldKnob2, knob1, knob2;
+float knob1, knob2;
 bool isGateHigh;
 
-// Delay
-float currentDelay;
-float delayFeedback;
-float delayTarget;
+// Last CC value each knob sent, -1 until it moves in the current mode, and
+// where it was when the mode started, -1 until the first reading
+int knobValue[2];
+float knobAnchor[2];
+uint32_t nextControlUs;
 
 float modeColorMap[4][3] = {
 	{1.0, 0.5, 0},
@@ -59,209 +69,112 @@ float modeColorMap[4][3] = {
 	{0, 1.0, 0},
 	{1.0, 0, 1.0}};
 
-void getReverbSample(float in1, float in2, float &out1, float &out2);
-void getDelaySample(float in1, float in2, float &out1, float &out2);
-
-void ConditionalParameter(float oldVal,
-						  float newVal,
-						  float &param,
-						  float update);
-
 void Controls();
+void ServiceControls();
 
-void NextSamples(float &signal)
+static void AudioCallback(AudioHandle::InputBuffer in,
+						  AudioHandle::OutputBuffer out,
+						  size_t size)
 {
-	float voiceSum = 0.0f;
+	loadMeter.beginBlock();
+	blockStartUs = System::GetUs();
+	blockSampleTime = engine.getSampleTime();
+	loadMeter.mark(LOAD_CONTROLS);
 
-	for (int i = 0; i < POLYSYNTH_VOICES; i++)
-	{
-		voiceSum += voices[i].getSample();
-	}
+	engine.process(out[0], out[1], size);
+	loadMeter.endBlock(size);
 
-	signal = voiceSum / POLYSYNTH_VOICES;
-	signal = filter.Process(signal);
+	// Fewer voices when the callback runs close to its budget
+	engine.updateVoiceLimit(loadMeter.getLoad(), loadMeter.getStageLoad(LOAD_VOICES));
 }
 
-static void AudioCallback(AudioHandle::InterleavingInputBuffer input,
-						  AudioHandle::InterleavingOutputBuffer output,
-						  size_t size)
+// Engine sample time for an event arriving now. Events are delayed by one
+// block so they land on the sample they arrived at, a constant latency
+// instead of jitter up to a block.
+uint32_t EventTime()
 {
-	Controls();
+	uint32_t sampleTime, startUs;
 
-	for (size_t i = 0; i < size; i += 2)
+	do
 	{
-		float signal;
-		float out1, out2;
-		NextSamples(signal);
-		getReverbSample(signal, signal, out1, out2);
-		getDelaySample(signal, signal, out1, out2);
+		sampleTime = blockSampleTime;
+		startUs = blockStartUs;
+	} while (sampleTime != blockSampleTime);
 
-		// left output
-		output[i] = out1;
-
-		// right output
-		output[i + 1] = out2;
-	}
+	uint32_t elapsed = (uint32_t)((System::GetUs() - startUs) * (sample_rate / 1000000.0f));
+	return sampleTime + AUDIO_BLOCK_SIZE + elapsed;
 }
 
-void handleNoteOn(int note, int millis)
+// Answers F0 7D 01 F7 with the load meter's counters, see loadmeter.h
+void HandleSysex(MidiEvent &m)
 {
-	bool foundVoice = false;
-
-	for (int i = 0; i < POLYSYNTH_VOICES; i++)
-	{
-		if (voices[i].note == -1)
-		{
-			voices[i].setFrequency(mtof(note));
-			voices[i].note = note;
-			voices[i].lastNoteMs = millis;
-			voices[i].trigger();
-			foundVoice = true;
-			break;
-		}
-	}
-
-	if (foundVoice)
+	if (m.sysex_message_len < 2 || m.sysex_data[0] != LOADMETER_SYSEX_ID || m.sysex_data[1] != LOADMETER_SYSEX_REQUEST)
 	{
 		return;
 	}
 
-	int stalestVoiceIndex = POLYSYNTH_VOICES - 1;
-	float stalestVoice = -1;
+	static uint8_t dump[LOADMETER_SYSEX_SIZE];
+	size_t size = loadMeter.writeSysex(dump, sizeof(dump));
 
-	for (int i = 0; i < POLYSYNTH_VOICES; i++)
+	if (size > 0)
 	{
-		if (stalestVoice == -1 || voices[i].lastNoteMs < stalestVoice)
-		{
-			stalestVoiceIndex = i;
-			stalestVoice = voices[i].lastNoteMs;
-		}
-	}
-
-	voices[stalestVoiceIndex].setFrequency(mtof(note));
-	voices[stalestVoiceIndex].note = note;
-	voices[stalestVoiceIndex].lastNoteMs = millis;
-	voices[stalestVoiceIndex].trigger();
-}
-
-void handleNoteOff(int note)
-{
-	for (int i = 0; i < POLYSYNTH_VOICES; i++)
-	{
-		if (voices[i].note == note)
-		{
-			voices[i].note = -1;
-			voices[i].release();
-			break;
-		}
-	}
-}
-
-void updateEnvelopeParams(int segment, float value)
-{
-	for (int i = 0; i < POLYSYNTH_VOICES; i++)
-	{
-		switch (segment)
-		{
-		case ADSR_SEG_ATTACK:
-		case ADSR_SEG_DECAY:
-		case ADSR_SEG_RELEASE:
-			voices[i].envelope.SetTime(segment, value);
-			break;
-		default:
-			voices[i].envelope.SetSustainLevel(value);
-			break;
-		}
+		pod.midi.SendMessage(dump, size);
 	}
 }
 
 // Typical Switch case for Message Type.
 void HandleMidiMessage(MidiEvent m)
 {
-	int millis = System::GetNow();
+	EngineEvent event;
+	event.time = EventTime();
 
 	switch (m.type)
 	{
 	case NoteOn:
 	{
 		NoteOnEvent p = m.AsNoteOn();
-		handleNoteOn(p.note, millis);
+		event.status = 0x90;
+		event.data0 = p.note;
+		event.data1 = p.velocity;
 	}
 	break;
 	case NoteOff:
 	{
-		NoteOnEvent p = m.AsNoteOn();
-		handleNoteOff(p.note);
+		NoteOffEvent p = m.AsNoteOff();
+		event.status = 0x80;
+		event.data0 = p.note;
+		event.data1 = p.velocity;
 	}
+	break;
 	case ControlChange:
 	{
 		ControlChangeEvent p = m.AsControlChange();
-		switch (p.control_number)
+		event.status = 0xb0;
+		event.data0 = p.control_number;
+		event.data1 = p.value;
+	}
+	break;
+	case PitchBend:
+	{
+		// Back to the 14 bit wire format, 8192 at rest
+		int value = m.AsPitchBend().value + 8192;
+		event.status = 0xe0;
+		event.data0 = value & 0x7f;
+		event.data1 = (value >> 7) & 0x7f;
+	}
+	break;
+	case SystemCommon:
+		if (m.sc_type == SystemExclusive)
 		{
-		case 96: // set voice profile
-			for (int i = 0; i < POLYSYNTH_VOICES; i++)
-			{
-				voices[i].setProfile(static_cast<Profile>(round((p.value / 127.0f) * numProfiles)));
-			}
-			break;
-		case 105: // detune voices
-			for (int i = 0; i < POLYSYNTH_VOICES; i++)
-			{
-				voices[i].detune = (p.value / 127.0f) * 4.0f;
-				voices[i].setFrequency();
-			}
-			break;
-		case 97: // Cutoff
-			filter.SetFreq(mtof((float)p.value));
-			break;
-		case 106: // Resonance
-			filter.SetRes(((float)p.value / 127.0f));
-			break;
-		case 98: // Attack
-			updateEnvelopeParams(ADSR_SEG_ATTACK, ((float)p.value / 127.0f) * 2.0f);
-			break;
-		case 107: // Decay
-			updateEnvelopeParams(ADSR_SEG_DECAY, ((float)p.value / 127.0f));
-			break;
-		case 99: // Sustain
-			updateEnvelopeParams(-1, (float)p.value / 127.0f);
-			break;
-		case 108: // Release
-			updateEnvelopeParams(ADSR_SEG_RELEASE, ((float)p.value / 127.0f));
-			break;
-		case 100: // LFO Frequency
-			// TODO: Make this logarithmic
-			for (int i = 0; i < POLYSYNTH_VOICES; i++)
-			{
-				voices[i].lfo.SetFreq(((float)p.value / 127.0f) * 1000.0f);
-			}
-			break;
-		case 109: // LFO Amplitude
-			for (int i = 0; i < POLYSYNTH_VOICES; i++)
-			{
-				voices[i].lfo.SetAmp((float)p.value / 127.0f);
-			}
-			break;
-		case 101: // Reverb mix
-			reverbMix = (float)p.value / 127.0f;
-			break;
-		case 110: // Reverb feedback
-			reverb.SetFeedback((float)p.value / 127.0f);
-			break;
-		case 102: // Delay feedback
-			delayFeedback = (float)p.value / 127.0f;
-			break;
-		case 111: // Delay time
-			currentDelay = delayTarget = sample_rate * ((float)p.value / 127.0f);
-			break;
-		default:
-			break;
+			HandleSysex(m);
 		}
-		break;
-	}
+		return;
 	default:
-		break;
+		return;
 	}
+
+	// The audio thread applies it, so nothing here touches engine state
+	engine.postEvent(event);
 }
 
 int main(void)
@@ -270,38 +183,23 @@ int main(void)
 	mode = VCO;
 	vibrato = 0.0f;
 	oscFreq = 1000.0f;
-	oldKnob1 = oldKnob2 = 0;
 	knob1 = knob2 = 0;
 	attack = .01f;
 	release = .2f;
 	cutoff = 10000;
-	reverbMix = 0.5f;
 
 	// Init everything
 	pod.Init();
-	pod.SetAudioBlockSize(4);
+	pod.SetAudioBlockSize(AUDIO_BLOCK_SIZE);
+	// SetAudioBlockSize sets the knob filters to the callback rate
+	pod.knob1.SetSampleRate(CONTROL_RATE_HZ);
+	pod.knob2.SetSampleRate(CONTROL_RATE_HZ);
 	sample_rate = pod.AudioSampleRate();
-	filter.Init(sample_rate);
-
-	// Set filter parameters
-	filter.SetFreq(10000);
-	filter.SetRes(0.8);
+	engine.initialize(sample_rate, &engineMemory);
 
-	reverb.Init(sample_rate);
-	reverb.SetLpFreq(18000.0f);
-	reverb.SetFeedback(0.85f);
-
-	delayLeft.Init();
-	delayRight.Init();
-	currentDelay = delayTarget = sample_rate * 0.75f;
-	delayFeedback = 0.5f;
-	delayLeft.SetDelay(currentDelay);
-	delayRight.SetDelay(currentDelay);
-
-	for (int i = 0; i < POLYSYNTH_VOICES; i++)
-	{
-		voices[i].initialize(sample_rate);
-	}
+	cycleCounterInit();
+	loadMeter.initialize(sample_rate);
+	engine.loadMeter = &loadMeter;
 
 	// set parameter parameters
 	cutoffParam.Init(pod.knob1, 100, 20000, cutoffParam.LOGARITHMIC);
@@ -313,6 +211,9 @@ int main(void)
 	pod.StartAdc();
 	pod.StartAudio(AudioCallback);
 	pod.midi.StartReceive();
+	knobValue[0] = knobValue[1] = -1;
+	knobAnchor[0] = knobAnchor[1] = -1.0f;
+	nextControlUs = System::GetUs();
 
 	while (1)
 	{
@@ -322,19 +223,30 @@ int main(void)
 		{
 			HandleMidiMessage(pod.midi.PopEvent());
 		}
+
+		ServiceControls();
 	}
 }
 
-// Updates values if knob had changed
-void ConditionalParameter(float oldVal,
-						  float newVal,
-						  float &param,
-						  float update)
+// Runs Controls() at CONTROL_RATE_HZ. After a stall the missed ticks are
+// dropped rather than run back to back.
+void ServiceControls()
 {
-	if (abs(oldVal - newVal) > 0.00005)
+	const uint32_t period = 1000000 / CONTROL_RATE_HZ;
+	uint32_t now = System::GetUs();
+
+	if ((int32_t)(now - nextControlUs) < 0)
 	{
-		param = update;
+		return;
 	}
+
+	nextControlUs += period;
+	if ((int32_t)(now - nextControlUs) >= 0)
+	{
+		nextControlUs = now + period;
+	}
+
+	Controls();
 }
 
 // Controls Helpers
@@ -346,7 +258,63 @@ void UpdateEncoder()
 	// 	osc[0].SetWaveform(wave[i]);
 	// }
 
-	mode = static_cast<ControlMode>((mode + pod.encoder.RisingEdge()) % static_cast<ControlMode>(__COUNT));
+	ControlMode next = static_cast<ControlMode>((mode + pod.encoder.RisingEdge()) % static_cast<ControlMode>(__COUNT));
+
+	if (next != mode)
+	{
+		mode = next;
+		knobValue[0] = knobValue[1] = -1;
+		knobAnchor[0] = knob1;
+		knobAnchor[1] = knob2;
+	}
+}
+
+// Posts a knob as a CC, or the top 7 bits of pitch bend for
+// KNOB_PITCH_BEND, the same path MIDI takes, whenever it moves to a new
+// value. After a mode change a knob only takes over once it moves, so
+// switching modes doesn't jump the new mode's parameters.
+void PostKnob(int knob, float value, int control)
+{
+	float position = value * 127.0f;
+
+	if (knobValue[knob] < 0)
+	{
+		if (knobAnchor[knob] < 0.0f)
+		{
+			knobAnchor[knob] = value;
+		}
+		if (fabsf(value - knobAnchor[knob]) < 0.01f)
+		{
+			return;
+		}
+	}
+	// Hysteresis, so noise at a step doesn't send a stream of CCs
+	else if (fabsf(position - knobValue[knob]) < 0.75f)
+	{
+		return;
+	}
+
+	int cc = (int)(position + 0.5f);
+	if (cc == knobValue[knob])
+	{
+		return;
+	}
+	knobValue[knob] = cc;
+
+	EngineEvent event;
+	event.time = EventTime();
+	if (control == KNOB_PITCH_BEND)
+	{
+		event.status = 0xe0;
+		event.data0 = 0;
+	}
+	else
+	{
+		event.status = 0xb0;
+		event.data0 = control;
+	}
+	event.data1 = cc;
+	engine.postEvent(event);
 }
 
 void UpdateKnobs()
@@ -354,34 +322,25 @@ void UpdateKnobs()
 	knob1 = pod.knob1.Process();
 	knob2 = pod.knob2.Process();
 
+	// CCs from SynthEngine::handleControlChange
 	switch (mode)
 	{
 	case VCO:
-		// ConditionalParameter(oldKnob1, knob1, oscFreq, pitchParam.Process());
-		// ConditionalParameter(oldKnob2, knob2, osc2DetuneAmt, osc2Detune.Process());
+		PostKnob(0, knob1, KNOB_PITCH_BEND); // Pitch, centred is in tune
+		PostKnob(1, knob2, 105);			 // Second oscillator detune
 		break;
 	case FILTER:
-		// ConditionalParameter(oldKnob1, knob1, cutoff, cutoffParam.Process());
-		// ConditionalParameter(oldKnob2, knob2, resonance, resonanceParam.Process());
-		// filter.SetFreq(cutoff);
-		// filter.SetRes(resonance);
+		PostKnob(0, knob1, 97);	 // Cutoff
+		PostKnob(1, knob2, 106); // Resonance
 		break;
 	case ENVELOPE:
-		// ConditionalParameter(oldKnob1, knob1, attack, pod.knob1.Process());
-		// ConditionalParameter(oldKnob2, knob2, release, pod.knob2.Process());
-		// envelope.SetTime(ADSR_SEG_ATTACK, attack);
-		// envelope.SetTime(ADSR_SEG_RELEASE, release);
+		PostKnob(0, knob1, 98);	 // Attack
+		PostKnob(1, knob2, 108); // Release
+		break;
+	case VCA:
+		PostKnob(0, knob1, 100); // LFO frequency
+		PostKnob(1, knob2, 109); // LFO amplitude
 		break;
-	// case LFO:
-	// 	ConditionalParameter(oldKnob1, knob1, lfoFreq, lfoParam.Process());
-	// 	ConditionalParameter(oldKnob2, knob2, lfoAmp, pod.knob2.Process());
-	// 	lfo.SetFreq(lfoFreq);
-	// 	lfo.SetAmp(lfoAmp * 100);
-	// case VCA:
-	// 	ConditionalParameter(oldKnob1, knob1, lfoFreq, lfoParam.Process());
-	// 	ConditionalParameter(oldKnob2, knob2, lfoAmp, pod.knob2.Process());
-	// 	lfo.SetFreq(lfoFreq);
-	// 	lfo.SetAmp(lfoAmp * 100);
 	default:
 		break;
 	}
@@ -390,10 +349,9 @@ void UpdateKnobs()
 void UpdateLeds()
 {
 	pod.led1.Set(modeColorMap[mode][0], modeColorMap[mode][1], modeColorMap[mode][2]);
-	pod.led2.Set(0, 1, 1);
-
-	oldKnob1 = knob1;
-	oldKnob2 = knob2;
+	// Green when idle, red when the audio callback uses its whole block
+	float load = fminf(loadMeter.getRecentLoad(), 1.0f);
+	pod.led2.Set(load, 1.0f - load, 0);
 
 	pod.UpdateLeds();
 }
@@ -421,28 +379,4 @@ void Controls()
 	UpdateLeds();
 
 	UpdateButtons();
-}
-
-void getReverbSample(float in1, float in2, float &out1, float &out2)
-{
-
-	reverb.Process(in1, in2, &out1, &out2);
-	out1 = reverbMix * out1 + (1 - reverbMix) * in1;
-	out2 = reverbMix * out2 + (1 - reverbMix) * in2;
-}
-
-void getDelaySample(float in1, float in2, float &out1, float &out2)
-{
-	fonepole(currentDelay, delayTarget, .00007f);
-	delayRight.SetDelay(currentDelay);
-	delayLeft.SetDelay(currentDelay);
-
-	out1 = delayRight.Read();
-	out2 = delayLeft.Read();
-
-	delayRight.Write((delayFeedback * out1) + in1);
-	out1 = (delayFeedback * out1) + in1;
-
-	delayLeft.Write((delayFeedback * out2) + in2);
-	out2 = (delayFeedback * out2) + in2;
 }
\ No newline at end of file
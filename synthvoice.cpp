@@ -1,56 +1,105 @@
 #include "synthvoice.h"
 #include "daisysp.h"
+#include "pitch.h"
+#include "waveshape.h"
 
 using namespace daisysp;
 
 SynthVoice::SynthVoice() {}
 SynthVoice::~SynthVoice() {}
 
-void SynthVoice::initialize(float sampleRate)
+void SynthVoice::initialize(float sampleRate, const WavetableSet *wavetables)
 {
     note = -1;
     detune = 1.0f;
+    level = 0.0f;
     frequency_ = 440.0f;
+    sampleRateRecip_ = 1.0f / sampleRate;
+    phase_[0] = phase_[1] = 0.0f;
 
-    oscillator[0].Init(sampleRate);
-    oscillator[0].SetFreq(frequency_);
-    oscillator[0].SetAmp(1);
+    wavetable[0].initialize(wavetables, sampleRate);
+    wavetable[1].initialize(wavetables, sampleRate);
+    useWavetables = false;
 
-    oscillator[1].Init(sampleRate);
-    oscillator[1].SetFreq(frequency_ * detune);
-    oscillator[1].SetAmp(1);
+    pitchRatio_ = 1.0f;
+    pitchOffset_ = 0.0f;
+    detuneRatio_ = 1.0f;
+    detuneOffset_ = 0.0f;
+    glideTime_ = 0.0f;
+    glide_ = 0.0f;
 
-    lfo.Init(sampleRate);
-    lfo.SetWaveform(SINE);
-    lfo.SetFreq(0.1);
-    lfo.SetAmp(0);
-
-    envelope.Init(sampleRate);
+    // Spread the unison start phases so the stack doesn't start out in phase
+    for (int k = 0; k < SYNTHVOICE_MAX_UNISON; k++)
+    {
+        float phase = k * 0.618034f;
+        unisonPhase_[k] = phase - (int)phase;
+        unisonRatio_[k] = 1.0f;
+    }
+    unison_ = 1;
 
     setProfile(DEFAULT);
+    setUnison(1, 0.0f, 0.0f);
+}
+
+static const ProfileSettings profileSettings[__P_COUNT] = {
+    {{SINE, TRIANGLE}, 2.0f},     // DEFAULT
+    {{TRIANGLE, SQUARE}, 1.3333f}, // NUMBER_2
+    {{SAW, SQUARE}, 0.5f},        // BUZZSAW
+};
+
+const ProfileSettings &getProfileSettings(Profile profile)
+{
+    if (profile < 0 || profile >= __P_COUNT)
+    {
+        profile = DEFAULT;
+    }
+    return profileSettings[profile];
 }
 
 void SynthVoice::setProfile(Profile nextProfile)
 {
-    switch (nextProfile)
+    const ProfileSettings &settings = getProfileSettings(nextProfile);
+    profile = nextProfile;
+
+    switch (settings.wave[0])
     {
-    case NUMBER_2:
-        oscillator[0].SetWaveform(oscillator[0].WAVE_TRI);
-        oscillator[1].SetWaveform(oscillator[1].WAVE_SQUARE);
-        detune = 1.3333f;
+    case TRIANGLE:
+        kernel_ = naiveKernel<TRIANGLE>(settings.wave[1]);
+        break;
+    case SAW:
+        kernel_ = naiveKernel<SAW>(settings.wave[1]);
         break;
-    case BUZZSAW:
-        oscillator[0].SetWaveform(oscillator[0].WAVE_SAW);
-        oscillator[1].SetWaveform(oscillator[1].WAVE_SQUARE);
-        detune = 0.5f;
+    case SQUARE:
+        kernel_ = naiveKernel<SQUARE>(settings.wave[1]);
         break;
-    case DEFAULT:
+    case SINE:
     default:
-        oscillator[0].SetWaveform(oscillator[0].WAVE_SIN);
-        oscillator[1].SetWaveform(oscillator[1].WAVE_TRI);
-        detune = 2.0f;
+        kernel_ = naiveKernel<SINE>(settings.wave[1]);
         break;
     }
+
+    wavetable[0].setWaveform(settings.wave[0]);
+    wavetable[1].setWaveform(settings.wave[1]);
+    detune = settings.detune;
+    selectUnisonKernel();
+    setFrequency();
+}
+
+template <Waveform Wave0>
+SynthVoice::Kernel SynthVoice::naiveKernel(Waveform wave1)
+{
+    switch (wave1)
+    {
+    case TRIANGLE:
+        return &SynthVoice::renderNaive<Wave0, TRIANGLE>;
+    case SAW:
+        return &SynthVoice::renderNaive<Wave0, SAW>;
+    case SQUARE:
+        return &SynthVoice::renderNaive<Wave0, SQUARE>;
+    case SINE:
+    default:
+        return &SynthVoice::renderNaive<Wave0, SINE>;
+    }
 }
 
 void SynthVoice::setFrequency()
@@ -61,13 +110,110 @@ void SynthVoice::setFrequency()
 void SynthVoice::setFrequency(float frequency)
 {
     frequency_ = frequency;
-    oscillator[0].SetFreq(frequency);
-    oscillator[1].SetFreq((frequency * detune));
+    frequency *= pitchRatio_;
+    phaseInc_[0] = frequency * sampleRateRecip_;
+    phaseInc_[1] = (frequency * detune * detuneRatio_) * sampleRateRecip_;
+
+    for (int k = 0; k < SYNTHVOICE_MAX_UNISON; k++)
+    {
+        unisonInc_[k] = frequency * unisonRatio_[k] * sampleRateRecip_;
+    }
+    wavetable[0].setFrequency(frequency);
+    wavetable[1].setFrequency(frequency * detune * detuneRatio_);
+}
+
+void SynthVoice::setUnison(int count, float semitones, float spread)
+{
+    unison_ = count < 1 ? 1 : (count > SYNTHVOICE_MAX_UNISON ? SYNTHVOICE_MAX_UNISON : count);
+
+    // About the loudness of the oscillator pair, whatever the count
+    const float gain = sqrtf(0.5f / unison_) * 1.41421356f;
+
+    for (int k = 0; k < SYNTHVOICE_MAX_UNISON; k++)
+    {
+        if (k >= unison_)
+        {
+            unisonRatio_[k] = 1.0f;
+            unisonLeft_[k] = unisonRight_[k] = 0.0f;
+            continue;
+        }
+
+        // Position in the stack from -1 to 1, pitch and pan follow it
+        float position = unison_ > 1 ? 2.0f * k / (unison_ - 1) - 1.0f : 0.0f;
+        float angle = (position * spread + 1.0f) * 0.785398163f;
+
+        unisonRatio_[k] = powf(2.0f, position * semitones / 12.0f);
+        unisonLeft_[k] = cosf(angle) * gain;
+        unisonRight_[k] = sinf(angle) * gain;
+    }
+
+    selectUnisonKernel();
+    setFrequency();
+}
+
+void SynthVoice::selectUnisonKernel()
+{
+    int vectors = (unison_ + SIMD_LANES - 1) / SIMD_LANES;
+
+    switch (getProfileSettings(profile).wave[0])
+    {
+    case TRIANGLE:
+        unisonKernel_ = stackKernel<TRIANGLE>(vectors);
+        break;
+    case SAW:
+        unisonKernel_ = stackKernel<SAW>(vectors);
+        break;
+    case SQUARE:
+        unisonKernel_ = stackKernel<SQUARE>(vectors);
+        break;
+    case SINE:
+    default:
+        unisonKernel_ = stackKernel<SINE>(vectors);
+        break;
+    }
 }
 
-void SynthVoice::trigger()
+template <Waveform Wave>
+SynthVoice::UnisonKernel SynthVoice::stackKernel(int vectors)
 {
-    envelope.Retrigger(false);
+    static_assert(SYNTHVOICE_MAX_UNISON == 2 * SIMD_LANES, "stackKernel covers one or two vectors");
+    return vectors > 1 ? &SynthVoice::renderStack<Wave, 2> : &SynthVoice::renderStack<Wave, 1>;
+}
+
+void SynthVoice::glideFrom(float semitones)
+{
+    glide_ = glideTime_ > 0.0f ? semitones : 0.0f;
+}
+
+bool SynthVoice::updatePitch(float semitones, float detuneSemitones, size_t size)
+{
+    float offset = semitones;
+
+    if (glide_ != 0.0f)
+    {
+        // Exponential approach, e^-t/T as 2^(-t/T * log2(e))
+        glide_ *= fastExp2(-1.442695f * size * sampleRateRecip_ / glideTime_);
+        glide_ = fabsf(glide_) < 0.001f ? 0.0f : glide_;
+        offset += glide_;
+    }
+
+    if (offset == pitchOffset_ && detuneSemitones == detuneOffset_)
+    {
+        return false;
+    }
+
+    if (offset != pitchOffset_)
+    {
+        pitchOffset_ = offset;
+        pitchRatio_ = semitonesToRatio(offset);
+    }
+    if (detuneSemitones != detuneOffset_)
+    {
+        detuneOffset_ = detuneSemitones;
+        detuneRatio_ = semitonesToRatio(detuneSemitones);
+    }
+    setFrequency();
+    return true;
 }
 
 void SynthVoice::release()
@@ -75,16 +221,87 @@ void SynthVoice::release()
     note = -1;
 }
 
-float SynthVoice::getSample()
+void SynthVoice::render(const float *envelope, float *out, size_t size)
 {
-    // TODO: This LFO isn't working right :(
-    // float vibrato = lfo.Process();
-    float level = envelope.Process(note > -1);
+    if (!useWavetables)
+    {
+        (this->*kernel_)(envelope, out, size);
+        return;
+    }
 
-    // setFrequency(frequency_ + vibrato);
+    for (size_t i = 0; i < size; i++)
+    {
+        float osc1 = wavetable[0].process();
+        float osc2 = wavetable[1].process();
 
-    float osc1 = oscillator[0].Process();
-    float osc2 = oscillator[1].Process();
+        out[i] = ((osc1 + osc2) / 2) * envelope[i];
+    }
+}
+
+template <Waveform Wave0, Waveform Wave1>
+void SynthVoice::renderNaive(const float *envelope, float *out, size_t size)
+{
+    float phase0 = phase_[0];
+    float phase1 = phase_[1];
+    const float inc0 = phaseInc_[0];
+    const float inc1 = phaseInc_[1];
 
-    return ((osc1 + osc2) / 2) * level;
-}
\ No newline at end of file
+    for (size_t i = 0; i < size; i++)
+    {
+        float osc = (WaveShape<Wave0>::sample(phase0) + WaveShape<Wave1>::sample(phase1)) * 0.5f;
+        out[i] = envelope[i] * osc;
+
+        phase0 = advancePhase(phase0, inc0);
+        phase1 = advancePhase(phase1, inc1);
+    }
+
+    phase_[0] = phase0;
+    phase_[1] = phase1;
+}
+
+void SynthVoice::renderUnison(const float *envelope, float *left, float *right, size_t size)
+{
+    (this->*unisonKernel_)(envelope, left, right, size);
+}
+
+template <Waveform Wave, int Vectors>
+void SynthVoice::renderStack(const float *envelope, float *left, float *right, size_t size)
+{
+    f32x4 phase[Vectors], inc[Vectors], gainLeft[Vectors], gainRight[Vectors];
+    for (int v = 0; v < Vectors; v++)
+    {
+        phase[v] = simdLoad(&unisonPhase_[v * SIMD_LANES]);
+        inc[v] = simdLoad(&unisonInc_[v * SIMD_LANES]);
+        gainLeft[v] = simdLoad(&unisonLeft_[v * SIMD_LANES]);
+        gainRight[v] = simdLoad(&unisonRight_[v * SIMD_LANES]);
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        f32x4 sumLeft = simdSet(0.0f);
+        f32x4 sumRight = simdSet(0.0f);
+
+        for (int v = 0; v < Vectors; v++)
+        {
+            f32x4 osc = WaveShape<Wave>::sample(phase[v]);
+            sumLeft += osc * gainLeft[v];
+            sumRight += osc * gainRight[v];
+            phase[v] = advancePhase(phase[v], inc[v]);
+        }
+
+        if (right)
+        {
+            right[i] = simdSum(sumRight) * envelope[i];
+            left[i] = envelope[i] * simdSum(sumLeft);
+        }
+        else
+        {
+            left[i] = envelope[i] * (simdSum(sumLeft + sumRight) * 0.5f);
+        }
+    }
+
+    for (int v = 0; v < Vectors; v++)
+    {
+        simdStore(&unisonPhase_[v * SIMD_LANES], phase[v]);
+    }
+}
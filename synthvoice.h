@@ -2,20 +2,12 @@
 #define SYNTHVOICE_H
 #include "daisysp.h"
 #include "reverbsc.h"
+#include "waveform.h"
+#include "wavetable.h"
 
 using namespace daisysp;
 
-enum Waveform
-{
-    SINE,
-    TRIANGLE,
-    SAW,
-    SQUARE,
-    // POLYBLEP_TRI,
-    // POLYBLEP_SAW,
-    // POLYBLEP_SQUARE,
-    __WF_COUNT
-};
+#define SYNTHVOICE_MAX_UNISON 8
 
 enum Profile
 {
@@ -25,30 +17,108 @@ enum Profile
     __P_COUNT
 };
 
+// Oscillator waveforms and detune ratio that make up a Profile
+struct ProfileSettings
+{
+    Waveform wave[2];
+    float detune;
+};
+
+const ProfileSettings &getProfileSettings(Profile profile);
+
 class SynthVoice
 {
 public:
     SynthVoice();
     ~SynthVoice();
 
-    Oscillator oscillator[2];
-    Oscillator lfo;
-    Adsr envelope;
+    WavetableOscillator wavetable[2];
+    bool useWavetables;
     Profile profile;
     int note;
     float detune;
+    // Envelope at the end of the last rendered block, the engine's
+    // EnvelopeBank runs the envelopes and keeps this up to date
+    float level;
     int lastNoteMs;
 
-    void initialize(float sampleRate);
+    void initialize(float sampleRate, const WavetableSet *wavetables);
     void setProfile(Profile profile);
+    // The note's frequency, before pitch modulation
     void setFrequency();
     void setFrequency(float frequency);
-    void trigger();
+    float getFrequency() const { return frequency_; }
+
+    // Pitch modulation on top of the note. The oscillators keep the note's
+    // phase increments and updatePitch scales them once per block, a
+    // multiply each, so the modulation costs no transcendental per sample.
+    // Time constant the pitch settles on a new note with, 0 jumps
+    void setGlide(float seconds) { glideTime_ = seconds; }
+    // Starts the note this many semitones away and glides it in, if glide is on
+    void glideFrom(float semitones);
+    // Advances the glide by size samples and applies it plus semitones, and
+    // detuneSemitones on the second oscillator. Returns true if the phase
+    // increments changed.
+    bool updatePitch(float semitones, float detuneSemitones, size_t size);
+    // Modulated frequency over the note's
+    float getPitchRatio() const { return pitchRatio_; }
+    // Modulated detune over detune
+    float getDetuneRatio() const { return detuneRatio_; }
     void release();
-    float getSample();
+    // Renders the oscillators times the block's envelope
+    void render(const float *envelope, float *out, size_t size);
+
+    // Unison stack of count oscillators playing the Profile's first
+    // waveform, detuned up to semitones either side of the note and panned
+    // across spread (0 to 1) of the stereo field
+    void setUnison(int count, float semitones, float spread);
+    // Renders the unison stack instead of the oscillator pair, always with
+    // the naive waveforms. With right null the stack is mixed to mono.
+    void renderUnison(const float *envelope, float *left, float *right, size_t size);
 
 private:
+    typedef void (SynthVoice::*Kernel)(const float *envelope, float *out, size_t size);
+    typedef void (SynthVoice::*UnisonKernel)(const float *envelope, float *left, float *right, size_t size);
+
     float frequency_;
+    float sampleRateRecip_;
+
+    // Pitch modulation, the offsets are the semitones last applied
+    float pitchRatio_;
+    float pitchOffset_;
+    float detuneRatio_;
+    float detuneOffset_;
+    float glideTime_;
+    float glide_;
+
+    // Naive oscillator pair, phases in [0, 1). setProfile picks the kernel
+    // compiled for the Profile's waveforms, render calls it once per block.
+    float phase_[2];
+    float phaseInc_[2];
+    Kernel kernel_;
+
+    template <Waveform Wave0, Waveform Wave1>
+    void renderNaive(const float *envelope, float *out, size_t size);
+
+    template <Waveform Wave0>
+    static Kernel naiveKernel(Waveform wave1);
+
+    // Unison oscillators as SIMD lanes, lanes past the count have no gain
+    int unison_;
+    float unisonPhase_[SYNTHVOICE_MAX_UNISON];
+    float unisonRatio_[SYNTHVOICE_MAX_UNISON];
+    float unisonInc_[SYNTHVOICE_MAX_UNISON];
+    float unisonLeft_[SYNTHVOICE_MAX_UNISON];
+    float unisonRight_[SYNTHVOICE_MAX_UNISON];
+    UnisonKernel unisonKernel_;
+
+    template <Waveform Wave, int Vectors>
+    void renderStack(const float *envelope, float *left, float *right, size_t size);
+
+    template <Waveform Wave>
+    static UnisonKernel stackKernel(int vectors);
+
+    void selectUnisonKernel();
 };
 
 #endif // SYNTHVOICE_H
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "voiceallocator.h"
+
+VoiceAllocator::VoiceAllocator() {}
+VoiceAllocator::~VoiceAllocator() {}
+
+void VoiceAllocator::initialize(const SynthVoice *voices, int numVoices)
+{
+    voices_ = voices;
+    numVoices_ = numVoices;
+    limit_ = numVoices;
+    busy_ = 0;
+    stealPolicy = STEAL_OLDEST;
+    resetStats();
+
+    for (int n = 0; n < VOICEALLOCATOR_NOTES; n++)
+    {
+        noteVoice_[n] = -1;
+    }
+
+    for (int l = 0; l < __LIST_COUNT; l++)
+    {
+        head_[l] = tail_[l] = -1;
+    }
+
+    for (int v = 0; v < numVoices; v++)
+    {
+        voiceNote_[v] = -1;
+        append(FREE, v);
+    }
+}
+
+void VoiceAllocator::resetStats()
+{
+    stats_.notes = 0;
+    stats_.retriggers = 0;
+    stats_.releasedSteals = 0;
+    stats_.heldSteals = 0;
+    stats_.shed = 0;
+}
+
+void VoiceAllocator::setVoiceLimit(int limit)
+{
+    limit_ = limit < 1 ? 1 : limit > numVoices_ ? numVoices_ : limit;
+}
+
+void VoiceAllocator::unlink(int voice)
+{
+    int list = list_[voice];
+    int prev = prev_[voice];
+    int next = next_[voice];
+
+    if (prev >= 0)
+    {
+        next_[prev] = next;
+    }
+    else
+    {
+        head_[list] = next;
+    }
+
+    if (next >= 0)
+    {
+        prev_[next] = prev;
+    }
+    else
+    {
+        tail_[list] = prev;
+    }
+}
+
+void VoiceAllocator::append(int list, int voice)
+{
+    list_[voice] = list;
+    prev_[voice] = tail_[list];
+    next_[voice] = -1;
+
+    if (tail_[list] >= 0)
+    {
+        next_[tail_[list]] = voice;
+    }
+    else
+    {
+        head_[list] = voice;
+    }
+    tail_[list] = voice;
+}
+
+int VoiceAllocator::quietestHeld() const
+{
+    int quietest = head_[HELD];
+
+    for (int v = next_[quietest]; v >= 0; v = next_[v])
+    {
+        if (voices_[v].level < voices_[quietest].level)
+        {
+            quietest = v;
+        }
+    }
+
+    return quietest;
+}
+
+// The released voice that was released longest ago, or else the held voice
+// the steal policy picks, whose note is taken from it
+int VoiceAllocator::stealVoice(int &stolenNote)
+{
+    if (head_[RELEASED] >= 0)
+    {
+        return head_[RELEASED];
+    }
+
+    int voice = stealPolicy == STEAL_QUIETEST ? quietestHeld() : head_[HELD];
+    stolenNote = voiceNote_[voice];
+    noteVoice_[stolenNote] = -1;
+    voiceNote_[voice] = -1;
+    return voice;
+}
+
+int VoiceAllocator::noteOn(int note, int &stolenNote)
+{
+    int voice = noteVoice_[note];
+    stolenNote = -1;
+    stats_.notes++;
+
+    if (voice >= 0)
+    {
+        // Retrigger the voice already playing the note instead of doubling it
+        stats_.retriggers++;
+    }
+    else if (head_[FREE] >= 0 && busy_ < limit_)
+    {
+        voice = head_[FREE];
+        busy_++;
+    }
+    else
+    {
+        voice = stealVoice(stolenNote);
+        if (stolenNote >= 0)
+        {
+            stats_.heldSteals++;
+        }
+        else
+        {
+            stats_.releasedSteals++;
+        }
+    }
+
+    unlink(voice);
+    append(HELD, voice);
+    voiceNote_[voice] = note;
+    noteVoice_[note] = voice;
+    return voice;
+}
+
+int VoiceAllocator::shedVoice(int &stolenNote)
+{
+    stolenNote = -1;
+
+    if (busy_ <= limit_)
+    {
+        return -1;
+    }
+
+    int voice = stealVoice(stolenNote);
+    unlink(voice);
+    append(FREE, voice);
+    busy_--;
+    stats_.shed++;
+    return voice;
+}
+
+int VoiceAllocator::noteOff(int note)
+{
+    int voice = noteVoice_[note];
+
+    if (voice < 0)
+    {
+        return -1;
+    }
+
+    noteVoice_[note] = -1;
+    voiceNote_[voice] = -1;
+    unlink(voice);
+    append(RELEASED, voice);
+    return voice;
+}
+
+void VoiceAllocator::voiceIdle(int voice)
+{
+    if (list_[voice] != RELEASED)
+    {
+        return;
+    }
+
+    unlink(voice);
+    append(FREE, voice);
+    busy_--;
+}
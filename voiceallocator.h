@@ -0,0 +1,100 @@
+#ifndef VOICEALLOCATOR_H
+#define VOICEALLOCATOR_H
+#include <stdint.h>
+#include "synthvoice.h"
+
+#define VOICEALLOCATOR_MAX_VOICES 64
+#define VOICEALLOCATOR_NOTES 128
+
+// Which voice gives way when every voice is holding a note
+enum StealPolicy
+{
+    // The voice whose note started longest ago, constant time
+    STEAL_OLDEST,
+    // The voice with the lowest envelope level, scans the held voices
+    STEAL_QUIETEST,
+};
+
+struct VoiceAllocatorStats
+{
+    uint32_t notes;
+    // Note ons that found the note already sounding and reused its voice
+    uint32_t retriggers;
+    // Note ons that took a voice from a released note that was still sounding
+    uint32_t releasedSteals;
+    // Note ons that cut off a held note
+    uint32_t heldSteals;
+    // Voices cut off because the voice limit went down
+    uint32_t shed;
+};
+
+// Tracks which voice plays which note. Voices sit in one of three lists,
+// free, released (still sounding) and held, each ordered from least to most
+// recently used. A note takes the free voice that has been idle longest,
+// then the voice that was released longest ago, which is the furthest into
+// its release, and only then a held voice. Everything except
+// STEAL_QUIETEST runs in constant time.
+//
+// The voice limit caps how many voices may be busy, held or released, at
+// once. At the limit a note steals even though free voices remain.
+class VoiceAllocator
+{
+public:
+    VoiceAllocator();
+    ~VoiceAllocator();
+
+    StealPolicy stealPolicy;
+
+    void initialize(const SynthVoice *voices, int numVoices);
+
+    // Returns the voice for note. stolenNote is the note the voice was
+    // holding, or -1.
+    int noteOn(int note, int &stolenNote);
+    // Returns the voice that held note, or -1 if no voice did
+    int noteOff(int note);
+    // The voice's release finished
+    void voiceIdle(int voice);
+
+    // Between 1 and the voice count. Lowering it leaves the busy voices
+    // sounding until shedVoice takes them.
+    void setVoiceLimit(int limit);
+    int getVoiceLimit() const { return limit_; }
+    // While more voices are busy than the limit allows, frees the one a
+    // note would steal first and returns it, with the note it was holding
+    // in stolenNote (or -1). Returns -1 once within the limit.
+    int shedVoice(int &stolenNote);
+
+    int getVoice(int note) const { return noteVoice_[note]; }
+    const VoiceAllocatorStats &getStats() const { return stats_; }
+    void resetStats();
+
+private:
+    enum List
+    {
+        FREE,
+        RELEASED,
+        HELD,
+        __LIST_COUNT
+    };
+
+    const SynthVoice *voices_;
+    int numVoices_;
+    int limit_;
+    int busy_;
+    VoiceAllocatorStats stats_;
+
+    int8_t noteVoice_[VOICEALLOCATOR_NOTES];
+    int8_t voiceNote_[VOICEALLOCATOR_MAX_VOICES];
+    int8_t list_[VOICEALLOCATOR_MAX_VOICES];
+    int8_t prev_[VOICEALLOCATOR_MAX_VOICES];
+    int8_t next_[VOICEALLOCATOR_MAX_VOICES];
+    int8_t head_[__LIST_COUNT];
+    int8_t tail_[__LIST_COUNT];
+
+    void unlink(int voice);
+    void append(int list, int voice);
+    int quietestHeld() const;
+    int stealVoice(int &stolenNote);
+};
+
+#endif // VOICEALLOCATOR_H
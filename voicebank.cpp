@@ -0,0 +1,119 @@
+#include "voicebank.h"
+
+VoiceBank::VoiceBank() {}
+VoiceBank::~VoiceBank() {}
+
+void VoiceBank::initialize(float sampleRate)
+{
+    sampleRateRecip_ = 1.0f / sampleRate;
+
+    for (int i = 0; i < VOICEBANK_MAX_VOICES; i++)
+    {
+        phase_[0][i] = phase_[1][i] = 0.0f;
+        setVoice(i, 440.0f, 1.0f);
+    }
+
+    setProfile(DEFAULT);
+}
+
+void VoiceBank::setProfile(Profile profile)
+{
+    const ProfileSettings &settings = getProfileSettings(profile);
+
+    switch (settings.wave[0])
+    {
+    case TRIANGLE:
+        renderGroup_ = groupKernel<TRIANGLE>(settings.wave[1]);
+        break;
+    case SAW:
+        renderGroup_ = groupKernel<SAW>(settings.wave[1]);
+        break;
+    case SQUARE:
+        renderGroup_ = groupKernel<SQUARE>(settings.wave[1]);
+        break;
+    case SINE:
+    default:
+        renderGroup_ = groupKernel<SINE>(settings.wave[1]);
+        break;
+    }
+}
+
+template <Waveform Wave0>
+VoiceBank::GroupKernel VoiceBank::groupKernel(Waveform wave1)
+{
+    switch (wave1)
+    {
+    case TRIANGLE:
+        return &VoiceBank::renderGroup<Wave0, TRIANGLE>;
+    case SAW:
+        return &VoiceBank::renderGroup<Wave0, SAW>;
+    case SQUARE:
+        return &VoiceBank::renderGroup<Wave0, SQUARE>;
+    case SINE:
+    default:
+        return &VoiceBank::renderGroup<Wave0, SINE>;
+    }
+}
+
+void VoiceBank::setVoice(int voice, float frequency, float detune)
+{
+    phaseInc_[0][voice] = frequency * sampleRateRecip_;
+    phaseInc_[1][voice] = (frequency * detune) * sampleRateRecip_;
+}
+
+void VoiceBank::render(const float *const *envelopes,
+                       float *const *out,
+                       int numVoices,
+                       const int *activeVoices,
+                       int numActive,
+                       size_t size)
+{
+    int lastFirst = -1;
+
+    for (int a = 0; a < numActive; a++)
+    {
+        int first = activeVoices[a] - activeVoices[a] % SIMD_LANES;
+        if (first == lastFirst)
+        {
+            continue;
+        }
+
+        int lanes = numVoices - first < SIMD_LANES ? numVoices - first : SIMD_LANES;
+        (this->*renderGroup_)(envelopes, out, first, lanes, size);
+        lastFirst = first;
+    }
+}
+
+template <Waveform Wave0, Waveform Wave1>
+void VoiceBank::renderGroup(const float *const *envelopes, float *const *out, int first, int lanes, size_t size)
+{
+    f32x4 phase0 = simdLoad(&phase_[0][first]);
+    f32x4 phase1 = simdLoad(&phase_[1][first]);
+    const f32x4 inc0 = simdLoad(&phaseInc_[0][first]);
+    const f32x4 inc1 = simdLoad(&phaseInc_[1][first]);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        float level[SIMD_LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int l = 0; l < lanes; l++)
+        {
+            level[l] = envelopes[first + l][i];
+        }
+
+        f32x4 osc = (WaveShape<Wave0>::sample(phase0) + WaveShape<Wave1>::sample(phase1)) * simdSet(0.5f);
+        osc *= simdLoad(level);
+
+        phase0 = advancePhase(phase0, inc0);
+        phase1 = advancePhase(phase1, inc1);
+
+        float sample[SIMD_LANES];
+        simdStore(sample, osc);
+        for (int l = 0; l < lanes; l++)
+        {
+            out[first + l][i] = sample[l];
+        }
+    }
+
+    simdStore(&phase_[0][first], phase0);
+    simdStore(&phase_[1][first], phase1);
+}
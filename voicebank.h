@@ -0,0 +1,55 @@
+#ifndef VOICEBANK_H
+#define VOICEBANK_H
+#include <stddef.h>
+#include "simd.h"
+#include "synthvoice.h"
+#include "waveshape.h"
+
+#define VOICEBANK_MAX_VOICES 64
+
+// Renders the oscillator pair of every voice with the voices laid out as
+// structure-of-arrays, SIMD_LANES voices per instruction. All voices share
+// the bank's Profile, so every lane runs the same waveform code: setProfile
+// picks the group kernel compiled for the Profile's waveform pair.
+class VoiceBank
+{
+public:
+    VoiceBank();
+    ~VoiceBank();
+
+    void initialize(float sampleRate);
+    void setProfile(Profile profile);
+    void setVoice(int voice, float frequency, float detune);
+
+    // envelopes and out hold one buffer per voice, the envelopes of the
+    // same lane groups as out. Only the lane groups holding one of the
+    // ascending activeVoices are rendered; idle lanes in those groups are
+    // written too.
+    void render(const float *const *envelopes,
+                float *const *out,
+                int numVoices,
+                const int *activeVoices,
+                int numActive,
+                size_t size);
+
+private:
+    typedef void (VoiceBank::*GroupKernel)(const float *const *envelopes,
+                                           float *const *out,
+                                           int first,
+                                           int lanes,
+                                           size_t size);
+
+    float sampleRateRecip_;
+    GroupKernel renderGroup_;
+
+    float phase_[2][VOICEBANK_MAX_VOICES];
+    float phaseInc_[2][VOICEBANK_MAX_VOICES];
+
+    template <Waveform Wave0, Waveform Wave1>
+    void renderGroup(const float *const *envelopes, float *const *out, int first, int lanes, size_t size);
+
+    template <Waveform Wave0>
+    static GroupKernel groupKernel(Waveform wave1);
+};
+
+#endif // VOICEBANK_H
@@ -0,0 +1,94 @@
+#include "voicegovernor.h"
+
+VoiceGovernor::VoiceGovernor() {}
+VoiceGovernor::~VoiceGovernor() {}
+
+void VoiceGovernor::initialize(int minVoices, int maxVoices)
+{
+    minVoices_ = minVoices;
+    maxVoices_ = maxVoices;
+    limit_ = lowestLimit_ = maxVoices;
+    headroomBlocks_ = 0;
+    wasOver_ = false;
+    cuts_ = 0;
+}
+
+int VoiceGovernor::update(float load, float voiceLoad, int activeVoices)
+{
+    // Nothing to learn about voice cost from a block without voices
+    if (activeVoices == 0)
+    {
+        headroomBlocks_ = 0;
+        wasOver_ = false;
+        return limit_;
+    }
+
+    float fixed = load - voiceLoad;
+    float perVoice = voiceLoad / activeVoices;
+
+    // A clock too coarse to time the voice stage, or a very short block,
+    // says nothing about what a voice costs
+    if (perVoice <= 0.0f)
+    {
+        return limit_;
+    }
+
+    if (load > VOICEGOVERNOR_TARGET)
+    {
+        headroomBlocks_ = 0;
+        if (!wasOver_)
+        {
+            wasOver_ = true;
+            lastFixed_ = fixed;
+            lastPerVoice_ = perVoice;
+            return limit_;
+        }
+
+        // The lighter of the two blocks
+        if (lastFixed_ + lastPerVoice_ * activeVoices < load)
+        {
+            fixed = lastFixed_;
+            perVoice = lastPerVoice_;
+        }
+        lastFixed_ = fixed;
+        lastPerVoice_ = perVoice;
+
+        // Dropping voices can't help a block the rest of the chain overran
+        float room = VOICEGOVERNOR_TARGET - fixed;
+        if (room <= 0.0f)
+        {
+            return limit_;
+        }
+
+        // Clamped before the cast, a tiny perVoice would overflow int
+        float fitVoices = room / perVoice;
+        int fit = fitVoices < maxVoices_ ? (int)fitVoices : maxVoices_;
+        fit = fit < minVoices_ ? minVoices_ : fit;
+
+        if (fit < limit_)
+        {
+            limit_ = fit;
+            lowestLimit_ = fit < lowestLimit_ ? fit : lowestLimit_;
+            cuts_++;
+        }
+        return limit_;
+    }
+
+    wasOver_ = false;
+
+    // Would one more voice than the limit still fit?
+    if (limit_ < maxVoices_ && fixed + perVoice * (limit_ + 1) < VOICEGOVERNOR_TARGET)
+    {
+        if (++headroomBlocks_ >= VOICEGOVERNOR_HOLD_BLOCKS)
+        {
+            limit_++;
+            headroomBlocks_ = 0;
+        }
+    }
+    else
+    {
+        headroomBlocks_ = 0;
+    }
+
+    return limit_;
+}
@@ -0,0 +1,49 @@
+#ifndef VOICEGOVERNOR_H
+#define VOICEGOVERNOR_H
+#include <stdint.h>
+
+// Block load, as a fraction of the block's duration, the governor keeps
+// the audio callback under
+#define VOICEGOVERNOR_TARGET 0.8f
+// Blocks the load has to leave room for one more voice before the limit
+// goes up, about 85 ms at 16 samples and 48 kHz
+#define VOICEGOVERNOR_HOLD_BLOCKS 256
+
+// Sets how many voices may sound from the measured load of each block.
+// The block's load splits into the voices' share, which scales with the
+// active voices, and a fixed rest for the effects. Two blocks in a row over
+// the target cut the limit to the voices that fit at the lighter block's
+// costs, so one late interrupt does not cost voices. The limit only goes
+// back up one voice at a time, after there has been room for another voice
+// for a while.
+class VoiceGovernor
+{
+public:
+    VoiceGovernor();
+    ~VoiceGovernor();
+
+    void initialize(int minVoices, int maxVoices);
+
+    // Feeds one block's load, the part of it the voices took and how many
+    // voices were sounding, returns the new limit
+    int update(float load, float voiceLoad, int activeVoices);
+
+    int getLimit() const { return limit_; }
+    // Lowest limit so far and how often the limit was cut
+    int getLowestLimit() const { return lowestLimit_; }
+    uint32_t getCuts() const { return cuts_; }
+
+private:
+    int minVoices_;
+    int maxVoices_;
+    int limit_;
+    int lowestLimit_;
+    int headroomBlocks_;
+    // Whether the previous block was over the target, and its costs
+    bool wasOver_;
+    float lastFixed_;
+    float lastPerVoice_;
+    uint32_t cuts_;
+};
+
+#endif // VOICEGOVERNOR_H
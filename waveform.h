@@ -0,0 +1,16 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+enum Waveform
+{
+    SINE,
+    TRIANGLE,
+    SAW,
+    SQUARE,
+    // POLYBLEP_TRI,
+    // POLYBLEP_SAW,
+    // POLYBLEP_SQUARE,
+    __WF_COUNT
+};
+
+#endif // WAVEFORM_H
@@ -0,0 +1,61 @@
+#ifndef WAVESHAPE_H
+#define WAVESHAPE_H
+#include <math.h>
+#include "simd.h"
+#include "waveform.h"
+
+// The naive waveforms of DaisySP's Oscillator for a phase in [0, 1), one
+// specialization per Waveform so kernels templated on it have no
+// per-sample switch. The f32x4 versions run SIMD_LANES voices at once.
+template <Waveform W>
+struct WaveShape;
+
+template <>
+struct WaveShape<SINE>
+{
+    static inline float sample(float phase) { return sinf(6.28318531f * phase); }
+    static inline f32x4 sample(f32x4 phase) { return simdSinPhase(phase); }
+};
+
+template <>
+struct WaveShape<TRIANGLE>
+{
+    static inline float sample(float phase) { return 2.0f * (fabsf(phase * 2.0f - 1.0f) - 0.5f); }
+
+    static inline f32x4 sample(f32x4 phase)
+    {
+        return simdSet(2.0f) * (simdAbs(phase * simdSet(2.0f) - simdSet(1.0f)) - simdSet(0.5f));
+    }
+};
+
+template <>
+struct WaveShape<SAW>
+{
+    static inline float sample(float phase) { return 1.0f - phase * 2.0f; }
+    static inline f32x4 sample(f32x4 phase) { return simdSet(1.0f) - phase * simdSet(2.0f); }
+};
+
+template <>
+struct WaveShape<SQUARE>
+{
+    static inline float sample(float phase) { return phase < 0.5f ? 1.0f : -1.0f; }
+
+    static inline f32x4 sample(f32x4 phase)
+    {
+        return simdSelect(simdLess(phase, simdSet(0.5f)), simdSet(1.0f), simdSet(-1.0f));
+    }
+};
+
+inline float advancePhase(float phase, float inc)
+{
+    phase += inc;
+    return phase > 1.0f ? phase - 1.0f : phase;
+}
+
+inline f32x4 advancePhase(f32x4 phase, f32x4 inc)
+{
+    phase += inc;
+    return simdSelect(simdGreater(phase, simdSet(1.0f)), phase - simdSet(1.0f), phase);
+}
+
+#endif // WAVESHAPE_H
@@ -0,0 +1,138 @@
+#include "wavetable.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static int maxHarmonic(int level)
+{
+    return (WAVETABLE_SIZE / 2) >> level;
+}
+
+// Fourier series matching the naive DaisySP shapes. Returns false for
+// harmonics the waveform doesn't have; useCos picks cosine partials.
+static bool harmonic(Waveform waveform, int h, double &amplitude, bool &useCos)
+{
+    useCos = false;
+
+    switch (waveform)
+    {
+    case TRIANGLE:
+        useCos = true;
+        amplitude = 8.0 / (M_PI * M_PI * h * h);
+        return h & 1;
+    case SAW:
+        amplitude = 2.0 / (M_PI * h);
+        return true;
+    case SQUARE:
+        amplitude = 4.0 / (M_PI * h);
+        return h & 1;
+    case SINE:
+    default:
+        amplitude = 1.0;
+        return h == 1;
+    }
+}
+
+// Adds one partial, stepping a rotation in double precision rather than
+// calling sin() for every sample so start-up stays quick on the Daisy.
+static void addHarmonic(float *table, int h, double amplitude, bool useCos)
+{
+    double step = 2.0 * M_PI * h / WAVETABLE_SIZE;
+    double c = cos(step), s = sin(step);
+    double x = 1.0, y = 0.0;
+
+    for (int i = 0; i < WAVETABLE_SIZE; i++)
+    {
+        table[i] += static_cast<float>(amplitude * (useCos ? x : y));
+        double nx = x * c - y * s;
+        y = x * s + y * c;
+        x = nx;
+    }
+}
+
+void WavetableSet::initialize()
+{
+    for (int w = 0; w < __WF_COUNT; w++)
+    {
+        Waveform waveform = static_cast<Waveform>(w);
+
+        // Build the sparsest level first, each lower level adds the next octave of partials
+        for (int level = WAVETABLE_LEVELS - 1; level >= 0; level--)
+        {
+            float *t = table[w][level];
+            int firstHarmonic = 1;
+
+            if (level == WAVETABLE_LEVELS - 1)
+            {
+                for (int i = 0; i < WAVETABLE_SIZE; i++)
+                {
+                    t[i] = 0.0f;
+                }
+            }
+            else
+            {
+                const float *previous = table[w][level + 1];
+                for (int i = 0; i < WAVETABLE_SIZE; i++)
+                {
+                    t[i] = previous[i];
+                }
+                firstHarmonic = maxHarmonic(level + 1) + 1;
+            }
+
+            for (int h = firstHarmonic; h <= maxHarmonic(level); h++)
+            {
+                double amplitude;
+                bool useCos;
+                if (harmonic(waveform, h, amplitude, useCos))
+                {
+                    addHarmonic(t, h, amplitude, useCos);
+                }
+            }
+
+            t[WAVETABLE_SIZE] = t[0];
+        }
+    }
+}
+
+WavetableOscillator::WavetableOscillator() {}
+WavetableOscillator::~WavetableOscillator() {}
+
+void WavetableOscillator::initialize(const WavetableSet *tables, float sampleRate)
+{
+    tables_ = tables;
+    sampleRateRecip_ = 1.0f / sampleRate;
+    waveform_ = SINE;
+    phase_ = 0.0f;
+    phaseInc_ = 440.0f * sampleRateRecip_;
+    selectTable();
+}
+
+void WavetableOscillator::setWaveform(Waveform waveform)
+{
+    waveform_ = waveform;
+    selectTable();
+}
+
+void WavetableOscillator::setFrequency(float frequency)
+{
+    float inc = frequency * sampleRateRecip_;
+    phaseInc_ = inc < 0.0f ? 0.0f : (inc > 0.5f ? 0.5f : inc);
+    selectTable();
+}
+
+void WavetableOscillator::selectTable()
+{
+    // Lowest level whose top partial stays below Nyquist at this increment
+    int level = 0;
+    float top = 1.0f / WAVETABLE_SIZE;
+
+    while (phaseInc_ > top && level < WAVETABLE_LEVELS - 1)
+    {
+        top *= 2.0f;
+        level++;
+    }
+
+    table_ = tables_->table[waveform_][level];
+}
@@ -0,0 +1,60 @@
+#ifndef WAVETABLE_H
+#define WAVETABLE_H
+#include "waveform.h"
+
+#define WAVETABLE_SIZE 1024
+#define WAVETABLE_LEVELS 10
+
+// One band-limited single cycle per waveform and octave. Level 0 holds
+// WAVETABLE_SIZE / 2 harmonics and each level up halves that, so a table
+// never aliases while the phase increment is at most 2^level / WAVETABLE_SIZE.
+// About 160KB, the engine keeps it in EngineMemory.
+struct WavetableSet
+{
+    // One guard sample at the end so reads can interpolate without wrapping
+    float table[__WF_COUNT][WAVETABLE_LEVELS][WAVETABLE_SIZE + 1];
+
+    void initialize();
+};
+
+// Oscillator that reads from a WavetableSet with linear interpolation.
+// Costs the same per sample whatever the waveform.
+class WavetableOscillator
+{
+public:
+    WavetableOscillator();
+    ~WavetableOscillator();
+
+    void initialize(const WavetableSet *tables, float sampleRate);
+    void setWaveform(Waveform waveform);
+    void setFrequency(float frequency);
+
+    inline float process()
+    {
+        float position = phase_ * WAVETABLE_SIZE;
+        int index = static_cast<int>(position);
+        float frac = position - index;
+        float a = table_[index];
+        float b = table_[index + 1];
+
+        phase_ += phaseInc_;
+        if (phase_ >= 1.0f)
+        {
+            phase_ -= 1.0f;
+        }
+
+        return a + (b - a) * frac;
+    }
+
+private:
+    const WavetableSet *tables_;
+    const float *table_;
+    Waveform waveform_;
+    float sampleRateRecip_;
+    float phase_;
+    float phaseInc_;
+
+    void selectTable();
+};
+
+#endif // WAVETABLE_H